@@ -0,0 +1,161 @@
+/**
+ * Topaz Benchmark - Integer Atom Encoding / Decoding
+ *
+ * Copyright (c) 2014, T Parys
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define __STDC_FORMAT_MACROS
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <inttypes.h>
+#include <topaz/atom.h>
+#include <topaz/atom_view.h>
+#include <topaz/exceptions.h>
+using namespace std;
+using namespace topaz;
+
+// Wall clock in seconds
+double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Keep optimizer from folding away repeated work on constant values
+inline void clobber(void *ptr)
+{
+    asm volatile("" : : "r"(ptr) : "memory");
+}
+
+// Iterations per test
+#define ITERS 2000000
+
+// Values of every encoded width, plus signed edge cases
+typedef struct
+{
+    char const *name;
+    bool        is_signed;
+    int64_t     val;
+} case_t;
+
+static case_t const cases[] =
+{
+    {"uint tiny (0x3f)",       false, 0x3f},
+    {"uint 1 byte (0xff)",     false, 0xff},
+    {"uint 2 bytes",           false, 0xffff},
+    {"uint 3 bytes",           false, 0xffffff},
+    {"uint 4 bytes",           false, 0xffffffffLL},
+    {"uint 5 bytes",           false, 0xffffffffffLL},
+    {"uint 6 bytes",           false, 0xffffffffffffLL},
+    {"uint 7 bytes",           false, 0xffffffffffffffLL},
+    {"uint 8 bytes",           false, -1},
+    {"int tiny (-0x20)",       true,  -0x20},
+    {"int tiny (0x1f)",        true,  0x1f},
+    {"int 1 byte (0x7f)",      true,  0x7f},
+    {"int 1 byte (-0x80)",     true,  -0x80},
+    {"int 2 bytes (0x80)",     true,  0x80},
+    {"int 2 bytes (-0x81)",    true,  -0x81},
+    {"int 4 bytes (-2^31)",    true,  INT32_MIN},
+    {"int 5 bytes (2^31)",     true,  0x80000000LL},
+    {"int 8 bytes (max)",      true,  INT64_MAX},
+    {"int 8 bytes (min)",      true,  INT64_MIN},
+    {NULL,                     false, 0}
+};
+
+void bench_case(case_t const &test)
+{
+    volatile int64_t input = test.val;
+    topaz::byte buf[16];
+    size_t len = 0;
+    uint64_t sum = 0;
+    atom dec;
+    double t_enc, t_dec, t_view;
+
+    // Encode (pick width, write out)
+    double start = now();
+    for (int i = 0; i < ITERS; i++)
+    {
+        if (test.is_signed)
+        {
+            len = atom::new_int(input).encode_bytes(buf);
+        }
+        else
+        {
+            len = atom::new_uint(input).encode_bytes(buf);
+        }
+        clobber(buf);
+    }
+    t_enc = now() - start;
+
+    // Decode into atom
+    start = now();
+    for (int i = 0; i < ITERS; i++)
+    {
+        dec.decode_bytes(buf, len);
+        sum += dec.get_type() == atom::INT ? (uint64_t)dec.get_int() : dec.get_uint();
+        clobber(buf);
+    }
+    t_dec = now() - start;
+
+    // Read in place
+    start = now();
+    for (int i = 0; i < ITERS; i++)
+    {
+        atom_view view(buf, len);
+        sum += test.is_signed ? (uint64_t)view.get_int() : view.get_uint();
+        clobber(buf);
+    }
+    t_view = now() - start;
+
+    // Sanity check
+    if (sum != (uint64_t)test.val * 2 * ITERS)
+    {
+        throw topaz_exception("Integer did not survive round trip");
+    }
+
+    printf("%-24s %2u bytes %8.2f ns enc %8.2f ns dec %8.2f ns view\n", test.name,
+           (unsigned)len, t_enc * 1e9 / ITERS, t_dec * 1e9 / ITERS, t_view * 1e9 / ITERS);
+}
+
+int main()
+{
+    try
+    {
+        printf("\nInteger atoms\n");
+        for (size_t i = 0; cases[i].name; i++)
+        {
+            bench_case(cases[i]);
+        }
+        printf("\n");
+    }
+    catch (topaz_exception &e)
+    {
+        printf("Exception raised: %s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
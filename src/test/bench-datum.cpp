@@ -0,0 +1,745 @@
+/**
+ * Topaz Benchmark - Datum Encoding / Decoding
+ *
+ * Copyright (c) 2014, T Parys
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define __STDC_FORMAT_MACROS
+#include <unistd.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+#include <new>
+#include <topaz/atom.h>
+#include <topaz/call_builder.h>
+#include <topaz/datum.h>
+#include <topaz/datum_builder.h>
+#include <topaz/datum_view.h>
+#include <topaz/exceptions.h>
+#include <topaz/schema.h>
+#include <topaz/token_parser.h>
+#include <topaz/uid.h>
+#include "token_index.h"
+using namespace std;
+using namespace topaz;
+
+// Heap accounting, eh ....
+uint64_t alloc_count = 0;
+uint64_t alloc_bytes = 0;
+int64_t  live_bytes = 0;
+
+// Room ahead of each block to remember its size
+#define ALLOC_HEADER 16
+
+void *operator new(size_t size)
+{
+    alloc_count++;
+    alloc_bytes += size;
+    live_bytes += size;
+    char *ptr = (char*)malloc(size + ALLOC_HEADER);
+    if (ptr == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    *(size_t*)ptr = size;
+    return ptr + ALLOC_HEADER;
+}
+
+// Replacement new/delete pair is intentionally malloc/free based
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void operator delete(void *ptr) noexcept
+{
+    if (ptr)
+    {
+        char *base = (char*)((uintptr_t)ptr - ALLOC_HEADER);
+        live_bytes -= *(size_t*)base;
+        free(base);
+    }
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+// Wall clock in seconds
+double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Keep optimizer from folding away repeated encodes of a constant call
+inline void clobber(void *ptr)
+{
+    asm volatile("" : : "r"(ptr) : "memory");
+}
+
+// Iterations per test
+#define ITERS 100000
+
+// Response to Locking_GlobalRange.Get[] (all columns)
+byte_vector make_get_response()
+{
+    datum row;
+    row[0].name()         = atom::new_uint(0);    // UID
+    row[0].named_value()  = atom::new_uid(LBA_RANGE_GLOBAL);
+    row[1].name()         = atom::new_uint(1);    // Name
+    row[1].named_value()  = atom::new_bin("Locking_GlobalRange");
+    row[2].name()         = atom::new_uint(2);    // CommonName
+    row[2].named_value()  = atom::new_bin("Locking_GlobalRange");
+    row[3].name()         = atom::new_uint(3);    // RangeStart
+    row[3].named_value()  = atom::new_uint(0);
+    row[4].name()         = atom::new_uint(4);    // RangeLength
+    row[4].named_value()  = atom::new_uint(0);
+    for (uint64_t col = 5; col <= 8; col++)       // Lock enables & states
+    {
+        row[col].name()        = atom::new_uint(col);
+        row[col].named_value() = atom::new_uint(col & 1);
+    }
+    row[9].name()            = atom::new_uint(9); // LockOnReset
+    row[9].named_value()[0]  = atom::new_uint(0);
+    row[10].name()           = atom::new_uint(10); // ActiveKey
+    row[10].named_value()    = atom::new_uid(_UID_MAKE(0x806, 0x1));
+    row[11].name()           = atom::new_uint(11); // NextKey
+    row[11].named_value()    = atom::new_uid(0);
+    row[12].name()           = atom::new_uint(12); // ReEncryptState
+    row[12].named_value()    = atom::new_uint(1);
+
+    datum rc;
+    rc[0] = row;
+
+    byte_vector bytes = rc.encode_vector();
+    return bytes;
+}
+
+// Tack method status list onto response
+void add_status(byte_vector &bytes)
+{
+    bytes.push_back(datum::TOK_END_OF_DATA);
+    bytes.push_back(datum::TOK_START_LIST);
+    bytes.push_back(0);
+    bytes.push_back(0);
+    bytes.push_back(0);
+    bytes.push_back(datum::TOK_END_LIST);
+}
+
+// Response to SessionManager.Properties[]
+byte_vector make_properties_response()
+{
+    static char const *names[] = {
+        "MaxMethods", "MaxSubpackets", "MaxPacketSize", "MaxPackets",
+        "MaxComPacketSize", "MaxResponseComPacketSize", "MaxSessions",
+        "MaxIndTokenSize", "MaxAuthentications", "MaxTransactionLimit",
+        "DefSessionTimeout", NULL
+    };
+    datum rc;
+    rc.object_uid() = SESSION_MGR;
+    rc.method_uid() = PROPERTIES;
+    datum &props = rc[0];
+    for (size_t i = 0; names[i]; i++)
+    {
+        props[i].name()        = atom::new_bin(names[i]);
+        props[i].named_value() = atom::new_uint(1 << (8 + i % 8));
+    }
+    rc[1].name()                = atom::new_uint(0); // HostProperties
+    rc[1].named_value()[0].name()        = atom::new_bin("MaxComPacketSize");
+    rc[1].named_value()[0].named_value() = atom::new_uint(65536);
+
+    byte_vector bytes = rc.encode_vector();
+    add_status(bytes);
+    return bytes;
+}
+
+// Response to SessionManager.StartSession[]
+byte_vector make_sync_session_response()
+{
+    datum rc;
+    rc.object_uid() = SESSION_MGR;
+    rc.method_uid() = SYNC_SESSION;
+    rc[0] = atom::new_uint(0x1001);     // Host Session ID
+    rc[1] = atom::new_uint(0x10000001); // TPer Session ID
+
+    byte_vector bytes = rc.encode_vector();
+    add_status(bytes);
+    return bytes;
+}
+
+// Token parser callbacks that do nothing (raw tokenizer speed)
+class null_handler : public token_handler
+{
+};
+
+// Specialised decoder - MaxComPacketSize from Properties[]
+class max_com_handler : public token_handler
+{
+  public:
+    max_com_handler() : depth(0), want(false), found(0) {}
+    void start_list() { depth++; }
+    void end_list() { depth--; }
+    void atom_token(atom_view const &val)
+    {
+        // Drive properties are named values in first list
+        if (want && (val.get_type() == atom::UINT))
+        {
+            found = val.get_uint();
+        }
+        want = false;
+        if ((depth == 1) && (val.get_type() == atom::BYTES))
+        {
+            byte_span_t name = val.get_bytes();
+            want = ((name.len == 16) && (memcmp(name.ptr, "MaxComPacketSize", 16) == 0));
+        }
+    }
+    bool done() const { return found != 0; }
+
+    int depth;
+    bool want;
+    uint64_t found;
+};
+
+// Report one test
+void report(char const *name, size_t bytes, double secs, uint64_t allocs)
+{
+    printf("%-32s %8.1f MB/s %10.1f ns/op %8.2f allocs/op\n", name,
+           (double)bytes * ITERS / secs / 1e6, secs * 1e9 / ITERS,
+           (double)allocs / ITERS);
+}
+
+void bench_decode(byte_vector const &bytes)
+{
+    double start;
+    uint64_t allocs;
+
+    // Fresh tree per decode (as drive::invoke() used to)
+    allocs = alloc_count;
+    start = now();
+    for (int i = 0; i < ITERS; i++)
+    {
+        datum rc;
+        rc.decode_vector(bytes);
+    }
+    report("decode (fresh datum)", bytes.size(), now() - start, alloc_count - allocs);
+
+    // Same tree reused for each decode (as drive::invoke_arena())
+    datum rc;
+    allocs = alloc_count;
+    start = now();
+    for (int i = 0; i < ITERS; i++)
+    {
+        rc.decode_vector(bytes);
+    }
+    report("decode (reused datum)", bytes.size(), now() - start, alloc_count - allocs);
+
+    // Only the fields wanted, read in place (as drive::invoke_view())
+    uint64_t sum = 0;
+    allocs = alloc_count;
+    start = now();
+    for (int i = 0; i < ITERS; i++)
+    {
+        datum_view row = datum_view(bytes)[0];
+        sum += row.find_by_name(3).get_uint();
+        sum += row.find_by_name(4).get_uint();
+        sum += row.find_by_name(7).get_uint();
+    }
+    report("view (3 fields)", bytes.size(), now() - start, alloc_count - allocs);
+    if (sum != ITERS)
+    {
+        printf("*** Unexpected field values ***\n");
+    }
+
+    // Fields wanted by tp_lock, found by name (as query_range() used to)
+    sum = 0;
+    allocs = alloc_count;
+    start = now();
+    for (int i = 0; i < ITERS; i++)
+    {
+        rc.decode_vector(bytes);
+        datum const &row = rc[0];
+        for (uint64_t col = 3; col <= 8; col++)
+        {
+            sum += row.find_by_name(col).value().get_uint();
+        }
+        sum += row.find_by_name(10).value().get_uid();
+    }
+    report("decode + find_by_name (7 fields)", bytes.size(), now() - start,
+           alloc_count - allocs);
+
+    // Whole row loaded in one pass
+    locking_range_t range;
+    allocs = alloc_count;
+    start = now();
+    for (int i = 0; i < ITERS; i++)
+    {
+        schema_decode(datum_view(bytes)[0], range);
+        sum += range.range_start + range.range_length + range.read_lock_enabled +
+            range.write_lock_enabled + range.read_locked + range.write_locked +
+            range.active_key;
+    }
+    report("schema_decode (whole row)", bytes.size(), now() - start, alloc_count - allocs);
+    clobber(&sum);
+}
+
+// Response to MBR.Get[] (binary table read)
+byte_vector make_bin_response(size_t len)
+{
+    byte_vector data(len, 0x5a);
+    datum rc;
+    rc[0] = atom::new_bin(data);
+
+    byte_vector bytes = rc.encode_vector();
+    return bytes;
+}
+
+void bench_bin(byte_vector const &bytes, size_t len)
+{
+    double start;
+    uint64_t allocs;
+    byte_vector out(len);
+
+    // Decode into reused tree, then copy out
+    datum rc;
+    allocs = alloc_count;
+    start = now();
+    for (int i = 0; i < ITERS; i++)
+    {
+        rc.decode_vector(bytes);
+        byte_vector const &rc_data = rc[0].value().get_bytes();
+        memcpy(&(out[0]), &(rc_data[0]), len);
+    }
+    report("decode + copy out", bytes.size(), now() - start, alloc_count - allocs);
+
+    // Copy straight out of response buffer
+    allocs = alloc_count;
+    start = now();
+    for (int i = 0; i < ITERS; i++)
+    {
+        byte_span_t rc_data = datum_view(bytes)[0].value().get_bytes();
+        memcpy(&(out[0]), rc_data.ptr, len);
+    }
+    report("view + copy out", bytes.size(), now() - start, alloc_count - allocs);
+}
+
+void bench_parse(byte_vector const &bytes)
+{
+    double start;
+    uint64_t allocs;
+
+    // Recursive decoder (as used by drive::invoke_arena())
+    datum rc;
+    allocs = alloc_count;
+    start = now();
+    for (int i = 0; i < ITERS; i++)
+    {
+        rc.decode_vector(bytes);
+    }
+    report("datum::decode_bytes (reused)", bytes.size(), now() - start, alloc_count - allocs);
+
+    // Tokens only
+    null_handler null;
+    allocs = alloc_count;
+    start = now();
+    for (int i = 0; i < ITERS; i++)
+    {
+        token_parser::parse(bytes, null);
+    }
+    report("token_parser (no-op)", bytes.size(), now() - start, alloc_count - allocs);
+
+    // Full tree, built from tokens
+    datum_builder builder(rc);
+    allocs = alloc_count;
+    start = now();
+    for (int i = 0; i < ITERS; i++)
+    {
+        builder.reset(rc);
+        token_parser::parse(bytes, builder);
+    }
+    report("token_parser + datum_builder", bytes.size(), now() - start, alloc_count - allocs);
+}
+
+// Flat list of (items) uints, in list nested (depth) deep
+byte_vector make_nested(size_t items, size_t depth)
+{
+    byte_vector bytes(depth, datum::TOK_START_LIST);
+    for (size_t i = 0; i < items; i++)
+    {
+        byte_vector tmp = atom::new_uint(i).encode_vector();
+        bytes.insert(bytes.end(), tmp.begin(), tmp.end());
+    }
+    bytes.insert(bytes.end(), depth, datum::TOK_END_LIST);
+    return bytes;
+}
+
+void bench_scaling()
+{
+    static size_t const sizes[][2] = {
+        {64, 1}, {1024, 1}, {16384, 1}, {60000, 1}, {1024, 16}, {1024, 31}, {0, 0}
+    };
+    char name[64];
+    datum rc;
+
+    printf("\nDecode scaling (reused datum)\n");
+    for (size_t i = 0; sizes[i][0]; i++)
+    {
+        byte_vector bytes = make_nested(sizes[i][0], sizes[i][1]);
+        int iters = ITERS / 100;
+
+        rc.decode_vector(bytes); // Warm up
+        uint64_t allocs = alloc_count;
+        double start = now();
+        for (int j = 0; j < iters; j++)
+        {
+            rc.decode_vector(bytes);
+        }
+        double secs = now() - start;
+
+        snprintf(name, sizeof(name), "%u items, depth %u", (unsigned)sizes[i][0],
+                 (unsigned)sizes[i][1]);
+        printf("%-32s %8.1f MB/s %10.2f ns/item %6.2f allocs/op\n", name,
+               (double)bytes.size() * iters / secs / 1e6,
+               secs * 1e9 / iters / sizes[i][0], (double)(alloc_count - allocs) / iters);
+    }
+
+    // Hostile input gets turned away quickly
+    byte_vector deep(1 << 20, datum::TOK_START_LIST);
+    int rejected = 0;
+    double start = now();
+    for (int j = 0; j < 1000; j++)
+    {
+        try
+        {
+            rc.decode_vector(deep);
+        }
+        catch (topaz_exception &e)
+        {
+            rejected++;
+        }
+    }
+    printf("%-32s %10.1f ns/op (%d of 1000 rejected)\n", "1 MiB of nested lists",
+           (now() - start) * 1e9 / 1000, rejected);
+}
+
+// Table dump (rows x columns of named uints)
+byte_vector make_table_dump(size_t rows, size_t cols)
+{
+    datum rc;
+    for (size_t r = 0; r < rows; r++)
+    {
+        for (size_t c = 0; c < cols; c++)
+        {
+            rc[0][r][c].name() = atom::new_uint(c);
+            rc[0][r][c].named_value() = atom::new_uint(r * cols + c);
+        }
+    }
+    return rc.encode_vector();
+}
+
+void bench_index()
+{
+    static size_t const rows = 256, cols = 13;
+    byte_vector bytes = make_table_dump(rows, cols);
+    int iters = ITERS / 100;
+    uint64_t sum = 0, allocs;
+    double start, secs;
+    token_index index;
+
+    printf("\nTable dump (%u rows x %u cols, %u bytes)\n", (unsigned)rows,
+           (unsigned)cols, (unsigned)bytes.size());
+
+    // Walk from the front to the wanted cell, every time
+    allocs = alloc_count;
+    start = now();
+    for (int i = 0; i < iters; i++)
+    {
+        size_t r = (i * 97) % rows;
+        sum += datum_view(bytes)[0][r].find_by_name(i % cols).get_uint();
+    }
+    secs = now() - start;
+    printf("%-32s %10.1f ns/op %8.2f allocs/op\n", "datum_view (one cell)",
+           secs * 1e9 / iters, (double)(alloc_count - allocs) / iters);
+
+    // Index the response once per call
+    index.build(bytes); // Warm up
+    allocs = alloc_count;
+    start = now();
+    for (int i = 0; i < iters; i++)
+    {
+        index.build(bytes);
+    }
+    secs = now() - start;
+    printf("%-32s %8.1f MB/s %10.1f ns/op %8.2f allocs/op\n", "token_index::build",
+           (double)bytes.size() * iters / secs / 1e6, secs * 1e9 / iters,
+           (double)(alloc_count - allocs) / iters);
+
+    // ... then every cell is a couple of table lookups away
+    start = now();
+    for (int i = 0; i < ITERS; i++)
+    {
+        size_t row = index.child(index.child(index.root(0), 0), (i * 97) % rows);
+        sum += index.get_atom(index.find_by_name(row, i % cols)).get_uint();
+    }
+    secs = now() - start;
+    printf("%-32s %10.1f ns/op\n", "token_index (one cell)", secs * 1e9 / ITERS);
+    clobber(&sum);
+
+    // Long runs of tiny atoms
+    bytes = make_nested(16384, 1);
+    index.build(bytes);
+    start = now();
+    for (int i = 0; i < iters; i++)
+    {
+        index.build(bytes);
+    }
+    secs = now() - start;
+    printf("%-32s %8.1f MB/s %10.2f ns/item\n", "token_index::build (16384 uints)",
+           (double)bytes.size() * iters / secs / 1e6, secs * 1e9 / iters / 16384);
+}
+
+// Memory footprint of decoded trees
+void bench_memory(byte_vector const &get_rc)
+{
+    static size_t const sizes[] = {1024, 60000, 0};
+    char name[64];
+
+    printf("\nMemory per node (sizeof atom %u, datum %u)\n",
+           (unsigned)sizeof(atom), (unsigned)sizeof(datum));
+
+    // Flat tables of tiny integers
+    for (size_t i = 0; sizes[i]; i++)
+    {
+        byte_vector bytes = make_nested(sizes[i], 1);
+        int64_t heap = live_bytes;
+        datum rc;
+        rc.decode_vector(bytes);
+        snprintf(name, sizeof(name), "list of %u uints", (unsigned)sizes[i]);
+        printf("%-32s %8.1f bytes/node\n", name,
+               (double)(live_bytes - heap + sizeof(datum)) / (sizes[i] + 1));
+    }
+
+    // Typical table row (2 lists, 13 named columns and their values,
+    // plus 1 item in LockOnReset list - 29 nodes in all)
+    int64_t heap = live_bytes;
+    datum rc;
+    rc.decode_vector(get_rc);
+    printf("%-32s %8.1f bytes/node\n", "Locking row Get[]",
+           (double)(live_bytes - heap + sizeof(datum)) / 29);
+}
+
+// Building atoms for a method call
+void bench_encode()
+{
+    topaz::byte buf[64];
+    size_t count = 0;
+    double start;
+    uint64_t allocs;
+
+    printf("\nMethod call atoms\n");
+
+    // Object and method UIDs, as every call encodes
+    allocs = alloc_count;
+    start = now();
+    for (int i = 0; i < ITERS; i++)
+    {
+        count += atom::new_uid(LBA_RANGE_GLOBAL).encode_bytes(buf);
+        count += atom::new_uid(GET).encode_bytes(buf);
+    }
+    report("object + method UIDs", 18, now() - start, alloc_count - allocs);
+
+    // Short name / PIN
+    allocs = alloc_count;
+    start = now();
+    for (int i = 0; i < ITERS; i++)
+    {
+        count += atom::new_bin("MaxComPacketSize").encode_bytes(buf);
+    }
+    report("16 byte binary", 18, now() - start, alloc_count - allocs);
+
+    // Full method call, with UID parameters
+    datum call;
+    call.object_uid() = SESSION_MGR;
+    call.method_uid() = START_SESSION;
+    call[0] = atom::new_uint(1);
+    call[1] = atom::new_uid(LOCKING_SP);
+    call[2] = atom::new_uint(1);
+    allocs = alloc_count;
+    start = now();
+    for (int i = 0; i < ITERS; i++)
+    {
+        count += call.encode_bytes(buf);
+        clobber(buf);
+    }
+    report("StartSession[] call", call.size(), now() - start, alloc_count - allocs);
+
+    // Same call, from the call builder
+    allocs = alloc_count;
+    start = now();
+    for (int i = 0; i < ITERS; i++)
+    {
+        count += swg::call(SESSION_MGR, START_SESSION, swg::uint(1), swg::uid(LOCKING_SP),
+                           swg::uint(1)).encode_bytes(buf);
+        clobber(buf);
+    }
+    report("StartSession[] (call builder)", call.size(), now() - start, alloc_count - allocs);
+
+    // Get[] of one column, building the datum each time (as drive used to)
+    allocs = alloc_count;
+    start = now();
+    for (int i = 0; i < ITERS; i++)
+    {
+        datum get;
+        get.object_uid() = LBA_RANGE_GLOBAL;
+        get.method_uid() = GET;
+        get[0][0].name()        = atom::new_uint(3);
+        get[0][0].named_value() = atom::new_uint(i & 0xf);
+        get[0][1].name()        = atom::new_uint(4);
+        get[0][1].named_value() = atom::new_uint(i & 0xf);
+        count += get.encode_bytes(buf);
+    }
+    report("Get[] column (datum)", 31, now() - start, alloc_count - allocs);
+
+    // ... versus call builder
+    allocs = alloc_count;
+    start = now();
+    for (int i = 0; i < ITERS; i++)
+    {
+        count += swg::call(LBA_RANGE_GLOBAL, GET,
+                           swg::cellblock(swg::start_col(i & 0xf),
+                                          swg::end_col(i & 0xf))).encode_bytes(buf);
+        clobber(buf);
+    }
+    report("Get[] column (call builder)", 31, now() - start, alloc_count - allocs);
+
+    if (count == 0)
+    {
+        printf("*** Nothing encoded ***\n");
+    }
+}
+
+// Parameters for a large Set[], as drive::table_set() builds them
+void bench_set(size_t len)
+{
+    byte_vector bytes;
+    uint64_t allocs = 0, heap = 0;
+    int iters = ITERS / 100;
+    double secs = 0;
+    char name[64];
+
+    for (int i = 0; i < iters; i++)
+    {
+        // Caller's data (not counted)
+        byte_vector payload(len, 0xa5);
+        uint64_t allocs_start = alloc_count, heap_start = alloc_bytes;
+        double start = now();
+
+        // Values = [ Column = Payload ]
+        datum params;
+        params[0].name()                         = atom::new_uint(1);
+        params[0].named_value()[0].name()        = atom::new_uint(3);
+        params[0].named_value()[0].named_value() = datum(atom::new_bin(std::move(payload)));
+
+        // Encode into reused buffer
+        params.encode_vector(bytes);
+
+        secs += now() - start;
+        allocs += alloc_count - allocs_start;
+        heap += alloc_bytes - heap_start;
+    }
+
+    snprintf(name, sizeof(name), "Set[] of %u KiB", (unsigned)(len / 1024));
+    printf("%-32s %10.1f us/op %8.2f allocs/op %10.1f KiB/op\n", name,
+           secs * 1e6 / iters, (double)allocs / iters, (double)heap / iters / 1024);
+
+    // Same Set[], encoded by call builder straight from caller's data
+    byte_vector payload(len, 0xa5);
+    allocs = alloc_count;
+    heap = alloc_bytes;
+    double start = now();
+    for (int i = 0; i < iters; i++)
+    {
+        swg::call(MBR_UID, SET, swg::where(0), swg::values(swg::bin(payload))).encode_vector(bytes);
+    }
+    secs = now() - start;
+    snprintf(name, sizeof(name), "Set[] of %u KiB (call builder)", (unsigned)(len / 1024));
+    printf("%-32s %10.1f us/op %8.2f allocs/op %10.1f KiB/op\n", name, secs * 1e6 / iters,
+           (double)(alloc_count - allocs) / iters, (double)(alloc_bytes - heap) / iters / 1024);
+}
+
+int main()
+{
+    try
+    {
+        byte_vector get_rc = make_get_response();
+
+        printf("\nGet[] response (%u bytes)\n", (unsigned int)get_rc.size());
+        bench_decode(get_rc);
+
+        printf("\nGet[] response (token parser)\n");
+        bench_parse(get_rc);
+
+        byte_vector props_rc = make_properties_response();
+        printf("\nProperties[] response (%u bytes)\n", (unsigned int)props_rc.size());
+        bench_parse(props_rc);
+        {
+            double start = now();
+            uint64_t allocs = alloc_count;
+            for (int i = 0; i < ITERS; i++)
+            {
+                max_com_handler max_com;
+                token_parser::parse(props_rc, max_com);
+            }
+            report("token_parser (MaxComPacketSize)", props_rc.size(), now() - start,
+                   alloc_count - allocs);
+        }
+
+        byte_vector sync_rc = make_sync_session_response();
+        printf("\nSyncSession[] response (%u bytes)\n", (unsigned int)sync_rc.size());
+        bench_parse(sync_rc);
+
+        bench_encode();
+        bench_scaling();
+        bench_index();
+        bench_memory(get_rc);
+
+        byte_vector bin_rc = make_bin_response(16384);
+        printf("\nBinary Get[] response (%u bytes)\n", (unsigned int)bin_rc.size());
+        bench_bin(bin_rc, 16384);
+
+        printf("\nBinary Set[] parameters\n");
+        bench_set(65536);
+        printf("\n");
+    }
+    catch (topaz_exception &e)
+    {
+        printf("Exception raised: %s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
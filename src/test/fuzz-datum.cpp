@@ -0,0 +1,234 @@
+/**
+ * Topaz Fuzzer - Datum Decoding
+ *
+ * libFuzzer harness over datum::decode_vector, cross checked against the
+ * token parser / datum builder, and datum views. Configure with
+ * -DTOPAZ_FUZZ=ON (and clang) for a real fuzzer; otherwise this builds as a
+ * replay tool which runs any inputs named on the command line, or a short
+ * random mutation run when given none.
+ *
+ * Copyright (c) 2014, T Parys
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <topaz/atom.h>
+#include <topaz/datum.h>
+#include <topaz/datum_builder.h>
+#include <topaz/datum_view.h>
+#include <topaz/exceptions.h>
+#include <topaz/token_parser.h>
+#include <topaz/uid.h>
+#include "token_index.h"
+using namespace std;
+using namespace topaz;
+
+// Decoders disagree - let the fuzzer know
+void oops(char const *what)
+{
+    printf("*** Mismatch: %s ***\n", what);
+    abort();
+}
+
+extern "C" int LLVMFuzzerTestOneInput(uint8_t const *data, size_t size)
+{
+    byte_vector bytes(data, data + size);
+    size_t full_len = 0, built_len = 0, view_len = 0;
+    bool full_ok = false, built_ok = false, view_ok = false;
+    datum full, built;
+    datum_builder builder(built);
+
+    // Main decoder (used for every response)
+    try
+    {
+        full_len = full.decode_vector(bytes);
+        full_ok = true;
+    }
+    catch (topaz_exception &e)
+    {
+    }
+
+    // Token parser + builder
+    try
+    {
+        built_len = token_parser::parse(bytes, builder);
+        built_ok = builder.done();
+    }
+    catch (topaz_exception &e)
+    {
+    }
+
+    // View (as used to find method status)
+    try
+    {
+        view_len = datum_view::skip((size ? &(bytes[0]) : NULL), size);
+        view_ok = true;
+    }
+    catch (topaz_exception &e)
+    {
+    }
+
+    // All three must agree
+    if ((full_ok != built_ok) || (full_ok != view_ok))
+    {
+        oops("accepted by some decoders, not others");
+    }
+
+    // Index must take whatever decoders did, and stop where they did
+    token_index index;
+    try
+    {
+        index.build(data, (full_ok ? full_len : size));
+        if (full_ok && ((index.count() != 1) || (index.get_entry(index.root(0)).size != full_len)))
+        {
+            oops("indexed length");
+        }
+
+        // ... and vice versa, for a lone datum
+        if (!full_ok && (index.count() == 1) &&
+            (index.get_token(index.root(0)) != datum::TOK_END_OF_DATA) &&
+            (index.get_token(index.root(0)) != datum::TOK_START_TRANS) &&
+            (index.get_token(index.root(0)) != datum::TOK_END_TRANS))
+        {
+            oops("accepted by index, not decoders");
+        }
+    }
+    catch (topaz_exception &e)
+    {
+        if (full_ok)
+        {
+            oops("accepted by decoders, not index");
+        }
+    }
+    if (!full_ok)
+    {
+        return 0;
+    }
+    if ((full_len != built_len) || (full_len != view_len))
+    {
+        oops("decoded length");
+    }
+    if (full != built)
+    {
+        oops("decoded contents");
+    }
+
+    // Decoded datum must survive a round trip
+    datum again;
+    again.decode_vector(full.encode_vector());
+    if (full != again)
+    {
+        oops("round trip");
+    }
+
+    return 0;
+}
+
+#ifdef FUZZ_REPLAY
+
+// Mutation rounds when run without inputs
+#define FUZZ_ROUNDS 200000
+
+// A realistic-ish response to start mutating from
+byte_vector make_seed()
+{
+    datum rc;
+    rc.object_uid() = SESSION_MGR;
+    rc.method_uid() = SYNC_SESSION;
+    rc[0] = atom::new_uint(0x1001);
+    rc[1].name() = atom::new_uint(3);
+    rc[1].named_value()[0] = atom::new_bin("Locking_GlobalRange");
+    rc[1].named_value()[1] = atom::new_int(-12345);
+    rc[1].named_value()[2][0] = atom::new_uid(LBA_RANGE_GLOBAL);
+    rc[2] = datum(datum::END_SESSION);
+
+    byte_vector bytes = rc.encode_vector();
+    return bytes;
+}
+
+int main(int argc, char **argv)
+{
+    // Replay inputs named on command line
+    if (argc > 1)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            byte_vector bytes;
+            FILE *fp = fopen(argv[i], "rb");
+            int c;
+
+            if (fp == NULL)
+            {
+                perror(argv[i]);
+                return 1;
+            }
+            while ((c = fgetc(fp)) != EOF)
+            {
+                bytes.push_back(c);
+            }
+            fclose(fp);
+
+            LLVMFuzzerTestOneInput(bytes.empty() ? NULL : &(bytes[0]), bytes.size());
+            printf("%s: OK\n", argv[i]);
+        }
+        return 0;
+    }
+
+    // Else, quick and dirty random mutation
+    byte_vector seed = make_seed();
+    srand(1);
+    for (int i = 0; i < FUZZ_ROUNDS; i++)
+    {
+        byte_vector bytes = seed;
+        int edits = 1 + rand() % 4;
+
+        for (int j = 0; j < edits; j++)
+        {
+            size_t pos = rand() % bytes.size();
+            switch (rand() % 3)
+            {
+                case 0:
+                    bytes[pos] = rand();
+                    break;
+                case 1:
+                    bytes.insert(bytes.begin() + pos, rand() % 2 ? 0xf0 : rand());
+                    break;
+                default:
+                    if (bytes.size() > 1)
+                    {
+                        bytes.erase(bytes.begin() + pos);
+                    }
+                    break;
+            }
+        }
+
+        LLVMFuzzerTestOneInput(&(bytes[0]), bytes.size());
+    }
+
+    printf("\n******** %d Inputs Passed ********\n\n", FUZZ_ROUNDS);
+    return 0;
+}
+
+#endif
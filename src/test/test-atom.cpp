@@ -29,9 +29,12 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include <inttypes.h>
 #include <topaz/atom.h>
+#include <topaz/atom_view.h>
 #include <topaz/exceptions.h>
+#include <topaz/uid.h>
 using namespace std;
 using namespace topaz;
 
@@ -190,6 +193,15 @@ void test_binary(atom::enc_t enc, size_t size)
 
     // Check
     check(atom::new_bin(raw), atom::BYTES, enc, size);
+
+    // Payload reads back the same, whether held inline or not
+    atom back = atom::new_bin(raw);
+    byte_span_t span = back.get_span();
+    if ((span.len != size) || (back.get_bytes() != raw) || (atom(back) != back))
+    {
+        printf("*** Failed (payload differs) ***\n");
+        exit(1);
+    }
 }
 
 
@@ -219,6 +231,82 @@ void test_uid(uint64_t val)
     }
 }
 
+void test_continued()
+{
+    static size_t const frags[] = {5, 300, 0, 3000, 7};
+    static size_t const nfrags = sizeof(frags) / sizeof(frags[0]);
+    byte_vector raw, encoded;
+    topaz::byte header[4];
+    size_t len;
+
+    // Debug
+    printf("\nContinued Binary Data: %u fragments\n", (unsigned int)nfrags);
+
+    // Encode each fragment, continued up until the last
+    for (size_t i = 0; i < nfrags; i++)
+    {
+        len = atom::encode_fragment_header(header, frags[i], i + 1 < nfrags);
+        encoded.insert(encoded.end(), header, header + len);
+        for (size_t j = 0; j < frags[i]; j++)
+        {
+            raw.push_back(0xff & (raw.size() * 7));
+            encoded.push_back(raw.back());
+        }
+    }
+    encoded.push_back(0x01); // Something else following
+
+    // Walk fragments in place
+    atom_view view(&(encoded[0]), encoded.size());
+    byte_span_t frag;
+    size_t pos = 0, idx = 0, offset = 0;
+    while (pos < view.size())
+    {
+        pos = view.next_fragment(pos, frag);
+        if ((idx >= nfrags) || (frag.len != frags[idx]) ||
+            (frag.len && memcmp(frag.ptr, &(raw[offset]), frag.len)))
+        {
+            printf("*** Failed (fragment %u differs) ***\n", (unsigned int)idx);
+            exit(1);
+        }
+        offset += frags[idx++];
+    }
+    if ((idx != nfrags) || (view.size() != encoded.size() - 1) ||
+        !view.is_continued() || (view.get_length() != raw.size()) ||
+        (view.get_string() != string(raw.begin(), raw.end())))
+    {
+        printf("*** Failed (fragment walk) ***\n");
+        exit(1);
+    }
+
+    // Put back together as one value
+    atom whole;
+    if ((whole.decode_bytes(&(encoded[0]), encoded.size()) != encoded.size() - 1) ||
+        (whole.get_type() != atom::BYTES) || (whole.get_bytes() != raw))
+    {
+        printf("*** Failed (decoded value differs) ***\n");
+        exit(1);
+    }
+
+    // Must end with binary data
+    size_t bad_len[] = {encoded.size() - 9, encoded.size() - 1};
+    encoded[encoded.size() - 9] = 0x01;
+    for (size_t i = 0; i < 2; i++)
+    {
+        try
+        {
+            whole.decode_bytes(&(encoded[0]), bad_len[i]);
+            printf("*** Failed (bad fragments accepted) ***\n");
+            exit(1);
+        }
+        catch (topaz_exception &e)
+        {
+            // Expected
+        }
+    }
+
+    test_count++;
+}
+
 int main()
 {
 
@@ -294,6 +382,9 @@ int main()
         // Max Long
         test_binary(atom::LONG, 0xffffff);
 
+        // Continued over several atoms
+        test_continued();
+
         //////////////////////////////////////////////////////////////////////////////
         // Misc Types
         //
@@ -301,6 +392,22 @@ int main()
         // Unique ID (Crazy integer that looks like a binary thing)
         test_uid(0x0f);
 
+        // Pre-encoded UIDs match atom encoding
+        printf("\nTesting pre-encoded UIDs ...\n");
+        for (size_t i = 0; i < sizeof(uid_names) / sizeof(uid_names[0]); i++)
+        {
+            uid_token_t token = uid_token(uid_names[i].uid);
+            byte_vector bytes = atom::new_uid(uid_names[i].uid).encode_vector();
+            if ((bytes.size() != sizeof(token)) ||
+                memcmp(&(bytes[0]), token.bytes, sizeof(token)) ||
+                (uid_name(uid_names[i].uid) == NULL))
+            {
+                printf("*** Failed (%s token differs) ***\n", uid_names[i].name);
+                exit(1);
+            }
+        }
+        test_count++;
+
         // Empty Atom
         printf("\n");
         atom empty;
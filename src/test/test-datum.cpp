@@ -29,9 +29,14 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <topaz/atom.h>
+#include <topaz/call_builder.h>
 #include <topaz/datum.h>
+#include <topaz/datum_builder.h>
+#include <topaz/datum_view.h>
 #include <topaz/exceptions.h>
+#include <topaz/schema.h>
 #include <topaz/uid.h>
+#include "token_index.h"
 using namespace std;
 using namespace topaz;
 
@@ -79,6 +84,22 @@ void dump(byte_vector test_bytes)
     printf("\n");
 }
 
+// Verify call builder matches datum encoding of same call
+template <class CALL>
+void check_call(CALL const &call, datum const &ref)
+{
+    byte_vector call_bytes;
+    call.encode_vector(call_bytes);
+    if ((call_bytes != ref.encode_vector()) || (call.size() != ref.size()) ||
+        (CALL::fixed_size && (CALL::fixed_size != ref.size())))
+    {
+        printf("*** Failed (call builder encoding differs) ***\n");
+        dump(call_bytes);
+        dump(ref.encode_vector());
+        exit(1);
+    }
+}
+
 // Verify data encoding
 void check(datum &test, datum::type_t type, size_t size)
 {
@@ -121,10 +142,46 @@ void check(datum &test, datum::type_t type, size_t size)
         exit(1);
     }
 
+    // Reconstruct via token parser
+    printf("Testing token parser copy ...\n");
+    datum built;
+    datum_builder builder(built);
+    if ((token_parser::parse(test_bytes, builder) != size) || (test != built))
+    {
+        printf("*** Failed (parsed object differs) ***\n");
+        exit(1);
+    }
+
+    // Walk encoded bytes in place
+    printf("Testing view of encoded bytes ...\n");
+    datum_view view(test_bytes);
+    if ((view.get_type() != type) || (view.size() != size) || (test != view.get_datum()))
+    {
+        printf("*** Failed (view differs) ***\n");
+        exit(1);
+    }
+
     // Bump the counter
     test_count++;
 }
 
+// Verify decoders reject data (views don't allocate, so have no item limit)
+bool decode_fails(byte_vector const &test_bytes, bool check_view)
+{
+    int failed = 0;
+    datum copy;
+    datum_builder builder(copy);
+
+    try { copy.decode_vector(test_bytes); } catch (topaz_exception &e) { failed++; }
+    try { token_parser::parse(test_bytes, builder); } catch (topaz_exception &e) { failed++; }
+    if (check_view)
+    {
+        try { datum_view(test_bytes).size(); } catch (topaz_exception &e) { failed++; }
+    }
+
+    return (failed == (check_view ? 3 : 2));
+}
+
 int main()
 {
 
@@ -154,6 +211,259 @@ int main()
         test.method_uid() = PROPERTIES;
         check(test, datum::METHOD, 21);
 
+        // Decoding over top of existing (larger) contents
+        test = datum();
+        test[0].value() = atom::new_int(1);
+        test[1].name() = atom::new_uint(2);
+        test[1].named_value() = atom::new_bin("two");
+        datum reused;
+        for (int i = 0; i < 5; i++)
+        {
+            reused[i][0].value() = atom::new_bin("stale");
+        }
+        printf("\nTesting decode over existing datum ...\n");
+        reused.decode_vector(test.encode_vector());
+        if (test != reused)
+        {
+            printf("*** Failed (decoded object differs) ***\n");
+            exit(1);
+        }
+        test_count++;
+
+        // Picking fields out of a view
+        byte_vector reused_bytes = test.encode_vector();
+        datum_view view(reused_bytes);
+        printf("\nTesting view field access ...\n");
+        if ((view.count() != 2) || (view[0].value().get_int() != 1) ||
+            (view.find_by_name(2).value().get_string() != "two"))
+        {
+            printf("*** Failed (view field differs) ***\n");
+            exit(1);
+        }
+        test_count++;
+
+        // Moving trees around, including out of their own parent
+        datum moved(std::move(reused));
+        moved[1] = atom::new_bin(byte_vector(100, 0x5a));
+        printf("\nTesting move of datum ...\n");
+        moved = std::move(moved[1]);
+        if ((reused.get_type() != datum::UNSET) || (moved.get_type() != datum::ATOM) ||
+            (moved.value().get_bytes() != byte_vector(100, 0x5a)))
+        {
+            printf("*** Failed (moved object differs) ***\n");
+            exit(1);
+        }
+        test_count++;
+
+        // Call builder, for fixed and variable sized calls
+        printf("\nTesting call builder ...\n");
+        byte_vector payload(3000, 0x5a);
+        for (size_t len = 0; len < payload.size(); len = len * 4 + 3)
+        {
+            test = datum();
+            test.object_uid() = MBR_UID;
+            test.method_uid() = SET;
+            test[0].name() = atom::new_uint(0);
+            test[0].named_value() = atom::new_uint(len * 1000);
+            test[1].name() = atom::new_uint(1);
+            test[1].named_value() = atom::new_bin(&(payload[0]), len);
+            check_call(swg::call(MBR_UID, SET, swg::where(len * 1000),
+                                 swg::values(swg::bin(&(payload[0]), len))), test);
+        }
+        test = datum();
+        test.object_uid() = SESSION_MGR;
+        test.method_uid() = START_SESSION;
+        test[0] = atom::new_uint(0x12345678);
+        test[1] = atom::new_uid(LOCKING_SP);
+        test[2] = atom::new_uint(1);
+        test[3].name() = atom::new_uint(0);
+        test[3].named_value() = atom::new_bin("password");
+        test[4].name() = atom::new_uint(3);
+        test[4].named_value() = atom::new_uid(ADMIN_BASE + 1);
+        check_call(swg::call(SESSION_MGR, START_SESSION, swg::uint(0x12345678),
+                             swg::uid(LOCKING_SP), swg::uint(1),
+                             swg::named<0>(swg::bin("password")),
+                             swg::named<3>(swg::uid(ADMIN_BASE + 1))), test);
+        test = datum();
+        test.object_uid() = LOCKING_SP;
+        test.method_uid() = REVERT;
+        check_call(swg::call(LOCKING_SP, REVERT), test);
+        test[0][0] = atom::new_uid(LOCKING_SP);
+        check_call(swg::call(LOCKING_SP, REVERT, swg::list(swg::uid(LOCKING_SP))), test);
+        test_count++;
+
+        // Structural index of a method response
+        printf("\nTesting token index ...\n");
+        test = datum();
+        for (int i = 0; i < 40; i++)
+        {
+            test[0][i].name() = atom::new_uint(i);
+            test[0][i].named_value() = atom::new_bin(byte_vector(i * 10, 0x5a));
+        }
+        test[1] = atom::new_uint(3);
+        reused_bytes = test.encode_vector();
+        reused_bytes.push_back(datum::TOK_END_OF_DATA);
+        datum status;
+        status[0] = atom::new_uint(0);
+        status[1] = atom::new_uint(0);
+        status[2] = atom::new_uint(0);
+        byte_vector status_bytes = status.encode_vector();
+        reused_bytes.insert(reused_bytes.end(), status_bytes.begin(), status_bytes.end());
+        token_index index;
+        index.build(reused_bytes);
+        size_t rc = index.root(0);
+        if ((index.count() != 3) || (index.child_count(rc) != 2) ||
+            (index.get_token(index.root(1)) != datum::TOK_END_OF_DATA) ||
+            (index.get_datum(rc).get_datum() != test) ||
+            (index.get_atom(index.child(rc, 1)).get_uint() != 3) ||
+            (index.get_atom(index.find_by_name(index.child(rc, 0), 33)).size() != 332))
+        {
+            printf("*** Failed (index differs) ***\n");
+            exit(1);
+        }
+
+        // ... and malformed framing turned away
+        static topaz::byte const bad[][4] = {
+            {0xf0, 0x01, 0x02, 0xf3}, // Wrong closing token
+            {0xf2, 0xf0, 0xf1, 0xf3}, // Name that isn't an atom
+            {0xf0, 0xf9, 0xf1, 0x00}, // End of Data inside a list
+            {0xf0, 0xa5, 0x00, 0xf1}, // Atom runs past end of data
+        };
+        for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+        {
+            try
+            {
+                index.build(bad[i], sizeof(bad[i]));
+                printf("*** Failed (malformed framing %u accepted) ***\n", (unsigned)i);
+                exit(1);
+            }
+            catch (topaz_exception &e)
+            {
+            }
+        }
+        test_count++;
+
+        // Get[] response loaded into row structure
+        printf("\nTesting table schemas ...\n");
+        test = datum();
+        test[0][0].name() = atom::new_uint(0);
+        test[0][0].named_value() = atom::new_uid(LOCKING_TABLE + 1);
+        test[0][1].name() = atom::new_uint(2);
+        test[0][1].named_value() = atom::new_bin("Range1");
+        test[0][2].name() = atom::new_uint(3);
+        test[0][2].named_value() = atom::new_uint(2048);
+        test[0][3].name() = atom::new_uint(4);
+        test[0][3].named_value() = atom::new_uint(0x100000);
+        test[0][4].name() = atom::new_uint(8);
+        test[0][4].named_value() = atom::new_uint(1);
+        test[0][5].name() = atom::new_uint(9);
+        test[0][5].named_value()[0] = atom::new_uint(0);
+        test[0][5].named_value()[1] = atom::new_uint(3);
+        test[0][6].name() = atom::new_uint(19); // Not in structure
+        test[0][6].named_value()[0] = atom::new_uint(7);
+        reused_bytes = test.encode_vector();
+        locking_range_t range;
+        schema_decode(datum_view(reused_bytes)[0], range);
+        if ((range.uid != LOCKING_TABLE + 1) || (range.range_start != 2048) ||
+            (range.range_length != 0x100000) || (range.write_locked != 1) ||
+            (range.read_locked != 0) || (range.common_name.len != 6) ||
+            memcmp(range.common_name.ptr, "Range1", 6) ||
+            (range.lock_on_reset != ((1 << schema::POWER_CYCLE) | (1 << schema::PROGRAMMATIC))) ||
+            !schema_has(range, 8) || schema_has(range, 7) || schema_has(range, 19))
+        {
+            printf("*** Failed (row structure differs) ***\n");
+            exit(1);
+        }
+
+        // ... absent columns (left zeroed) turned away when required
+        uint64_t const sent_cols[] = {0, 2, 3, 4, 8, 9};
+        uint64_t const more_cols[] = {3, 4, 7, 8};
+        schema_require(range, sent_cols, 6);
+        try
+        {
+            schema_require(range, more_cols, 4);
+            printf("*** Failed (missing column accepted) ***\n");
+            exit(1);
+        }
+        catch (topaz_exception &e)
+        {
+        }
+
+        // ... and column of the wrong type turned away
+        test[0][2].named_value() = atom::new_bin("oops");
+        reused_bytes = test.encode_vector();
+        try
+        {
+            schema_decode(datum_view(reused_bytes)[0], range);
+            printf("*** Failed (mistyped column accepted) ***\n");
+            exit(1);
+        }
+        catch (topaz_exception &e)
+        {
+        }
+        test_count++;
+
+        // Binary data written in fragments, read back as one value
+        printf("\nTesting continued binary data ...\n");
+        for (size_t len = 0; len < payload.size(); len = len * 4 + 3)
+        {
+            for (size_t i = 0; i < len; i++)
+            {
+                payload[i] = 0xff & (i * 13);
+            }
+            topaz::byte const *src = &(payload[0]);
+            byte_vector call_bytes;
+            swg::call(MBR_UID, SET, swg::where(0),
+                      swg::values(swg::stream(len, 100, [src](topaz::byte *out, size_t offset,
+                                                             size_t frag)
+                                              {
+                                                  memcpy(out, src + offset, frag);
+                                              }))).encode_vector(call_bytes);
+            test = datum();
+            test.object_uid() = MBR_UID;
+            test.method_uid() = SET;
+            test[0].name() = atom::new_uint(0);
+            test[0].named_value() = atom::new_uint(0);
+            test[1].name() = atom::new_uint(1);
+            test[1].named_value() = atom::new_bin(&(payload[0]), len);
+            reused.decode_vector(call_bytes);
+            index.build(call_bytes);
+            if ((reused != test) || (datum_view(call_bytes).size() != call_bytes.size()) ||
+                (index.get_atom(index.find_by_name(index.root(0), 1)).get_length() != len))
+            {
+                printf("*** Failed (continued data differs) ***\n");
+                dump(call_bytes);
+                exit(1);
+            }
+        }
+        test_count++;
+
+        // Hostile input - nesting deep enough to blow a recursive decoder
+        byte_vector deep(1000000, datum::TOK_START_LIST);
+        printf("\nTesting decode limits ...\n");
+        if (!decode_fails(deep, true))
+        {
+            printf("*** Failed (deep nesting accepted) ***\n");
+            exit(1);
+        }
+
+        // Hostile input - more items than allowed
+        size_t max_depth = datum::get_decode_max_depth();
+        size_t max_nodes = datum::get_decode_max_nodes();
+        datum::set_decode_limits(max_depth, 10);
+        for (int i = 0; i < 10; i++)
+        {
+            reused[i] = atom::new_uint(i);
+        }
+        bool too_many = decode_fails(reused.encode_vector(), false);
+        datum::set_decode_limits(max_depth, max_nodes);
+        if (!too_many)
+        {
+            printf("*** Failed (item limit ignored) ***\n");
+            exit(1);
+        }
+        test_count++;
+
         printf("\n******** %d Tests Passed ********\n\n", test_count);
     }
     catch (topaz_exception &e)
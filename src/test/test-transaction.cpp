@@ -0,0 +1,234 @@
+/**
+ * Topaz Test - Transaction Packing / Status Decoding
+ *
+ * Copyright (c) 2014, T Parys
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <topaz/datum.h>
+#include <topaz/exceptions.h>
+#include <topaz/transaction.h>
+using namespace std;
+using namespace topaz;
+
+// Global, eh ....
+int test_count = 0;
+
+// Build byte vector from a list of bytes
+byte_vector make_bytes(topaz::byte const *data, size_t len)
+{
+    return byte_vector(data, data + len);
+}
+
+// Check calls packed into one ComPacket
+void check_pack(vector<size_t> const &call_ends, size_t first, size_t room,
+                size_t max_methods, size_t expect)
+{
+    printf("Packing from call %zu (%zu bytes, %zu methods) ...\n",
+           first, room, max_methods);
+
+    size_t last = transaction::pack(call_ends, first, room, max_methods);
+    if (last != expect)
+    {
+        printf("*** Failed (packed up to %zu, expected %zu) ***\n", last, expect);
+        exit(1);
+    }
+
+    test_count++;
+}
+
+// Check decoding fails on malformed response
+void check_decode_fails(byte_vector const &resp, size_t count)
+{
+    datum::status_t statuses[4];
+
+    printf("Decoding malformed response (%zu bytes) ...\n", resp.size());
+    try
+    {
+        transaction::decode_statuses(resp, 0, count, statuses);
+        printf("*** Failed (malformed response accepted) ***\n");
+        exit(1);
+    }
+    catch (topaz_exception &e)
+    {
+        // Expected
+    }
+
+    test_count++;
+}
+
+int main()
+{
+
+    try
+    {
+        //////////////////////////////////////////////////////////////////////////////
+        // Packing calls into ComPackets
+        //
+
+        // Four calls, 30 bytes each
+        vector<size_t> call_ends;
+        for (size_t i = 1; i <= 4; i++)
+        {
+            call_ends.push_back(i * 30);
+        }
+
+        // Limited by size
+        check_pack(call_ends, 0, 100, 16, 3);
+
+        // Limited by method count
+        check_pack(call_ends, 0, 1000, 2, 2);
+
+        // Opal only guarantees one method
+        check_pack(call_ends, 1, 1000, 1, 2);
+
+        // Picks up where the last ComPacket left off
+        check_pack(call_ends, 3, 100, 16, 4);
+
+        // Exact fit
+        check_pack(call_ends, 0, 120, 16, 4);
+
+        // Call too big for ComPacket
+        check_pack(call_ends, 0, 29, 16, 0);
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Decoding per-call statuses
+        //
+
+        // Three calls: empty response, response of one item, failed call
+        topaz::byte three[] = {
+            0xf0, 0xf1, 0xf9, 0xf0, 0x00, 0x00, 0x00, 0xf1,
+            0xf0, 0x05, 0xf1, 0xf9, 0xf0, 0x00, 0x00, 0x00, 0xf1,
+            0xf0, 0xf1, 0xf9, 0xf0, 0x0c, 0x00, 0x00, 0xf1
+        };
+        datum::status_t statuses[4];
+        printf("Decoding three call statuses ...\n");
+        if ((transaction::decode_statuses(make_bytes(three, sizeof(three)), 0, 3, statuses) != 3) ||
+            (statuses[0] != datum::STA_SUCCESS) || (statuses[1] != datum::STA_SUCCESS) ||
+            (statuses[2] != datum::STA_INVALID_PARAMETER))
+        {
+            printf("*** Failed (statuses differ) ***\n");
+            exit(1);
+        }
+        test_count++;
+
+        // Drive stops short after a failure, and ends transaction itself
+        topaz::byte short_resp[] = {
+            0xf0, 0xf1, 0xf9, 0xf0, 0x01, 0x00, 0x00, 0xf1,
+            0xfc, 0x01
+        };
+        printf("Decoding statuses of drive stopping short ...\n");
+        if ((transaction::decode_statuses(make_bytes(short_resp, sizeof(short_resp)), 0, 3, statuses) != 1) ||
+            (statuses[0] != datum::STA_NOT_AUTHORIZED))
+        {
+            printf("*** Failed (expected one status) ***\n");
+            exit(1);
+        }
+        test_count++;
+
+        // Behind Start Transaction (and its status)
+        topaz::byte started[] = {
+            0xfb, 0x00,
+            0xf0, 0xf1, 0xf9, 0xf0, 0x00, 0x00, 0x00, 0xf1,
+            0xf0, 0xf1, 0xf9, 0xf0, 0x03, 0x00, 0x00, 0xf1
+        };
+        printf("Decoding statuses behind Start Transaction ...\n");
+        if ((transaction::decode_trans_status(make_bytes(started, sizeof(started)),
+                                              datum::TOK_START_TRANS) != 0) ||
+            (transaction::decode_statuses(make_bytes(started, sizeof(started)), 2, 2, statuses) != 2) ||
+            (statuses[0] != datum::STA_SUCCESS) || (statuses[1] != datum::STA_SP_BUSY))
+        {
+            printf("*** Failed (statuses differ) ***\n");
+            exit(1);
+        }
+        test_count++;
+
+        // Nothing at all
+        printf("Decoding statuses of empty response ...\n");
+        if (transaction::decode_statuses(byte_vector(), 0, 2, statuses) != 0)
+        {
+            printf("*** Failed (expected no status) ***\n");
+            exit(1);
+        }
+        test_count++;
+
+        // Truncated status list
+        check_decode_fails(make_bytes(three, 6), 1);
+
+        // Status list of wrong length
+        topaz::byte long_list[] = {
+            0xf0, 0xf1, 0xf9, 0xf0, 0x00, 0x00, 0x00, 0x00, 0xf1
+        };
+        check_decode_fails(make_bytes(long_list, sizeof(long_list)), 1);
+
+        // Missing End of Data
+        topaz::byte no_eod[] = {
+            0xf0, 0xf1, 0xf0, 0x00, 0x00, 0x00, 0xf1
+        };
+        check_decode_fails(make_bytes(no_eod, sizeof(no_eod)), 1);
+
+        //////////////////////////////////////////////////////////////////////////////
+        // Decoding Start / End Transaction status
+        //
+
+        topaz::byte start_ok[] = {0xfb, 0x00};
+        topaz::byte end_abort[] = {0xfc, 0x01};
+        printf("Decoding transaction statuses ...\n");
+        if ((transaction::decode_trans_status(make_bytes(start_ok, 2), datum::TOK_START_TRANS) != 0) ||
+            (transaction::decode_trans_status(make_bytes(end_abort, 2), datum::TOK_END_TRANS) != 1))
+        {
+            printf("*** Failed (transaction status differs) ***\n");
+            exit(1);
+        }
+        test_count++;
+
+        // Wrong token, or no status
+        byte_vector bad[] = {make_bytes(start_ok, 2), make_bytes(end_abort, 1)};
+        printf("Decoding malformed transaction statuses ...\n");
+        for (size_t i = 0; i < 2; i++)
+        {
+            try
+            {
+                transaction::decode_trans_status(bad[i], datum::TOK_END_TRANS);
+                printf("*** Failed (malformed transaction status accepted) ***\n");
+                exit(1);
+            }
+            catch (topaz_exception &e)
+            {
+                // Expected
+            }
+        }
+        test_count++;
+
+        printf("\n******** %d Tests Passed ********\n\n", test_count);
+    }
+    catch (topaz_exception &e)
+    {
+        printf("Exception raised: %s\n", e.what());
+    }
+
+    return 0;
+}
@@ -0,0 +1,406 @@
+/**
+ * Topaz - Token Index
+ *
+ * This class makes one pass over an encoded token stream, checking its
+ * framing and recording where every item starts and ends. Afterwards,
+ * the Nth item of any list (or the value of any named column) can be
+ * found directly, without walking over everything before it.
+ *
+ * Copyright (c) 2014, T Parys
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include <topaz/datum.h>
+#include <topaz/exceptions.h>
+#include "token_index.h"
+using namespace topaz;
+
+/**
+ * \brief Constructor
+ */
+token_index::token_index()
+    : data(NULL), len(0)
+{
+    // Nothing indexed yet
+    entry_t root = {0, 0, 0, 0};
+    entries.push_back(root);
+}
+
+/**
+ * \brief Index buffer of encoded tokens
+ *
+ * @param data Location of encoded tokens (must outlive index)
+ * @param len  Length of buffer
+ */
+void token_index::build(byte const *data, size_t len)
+{
+    size_t pos = 0, max_depth = datum::get_decode_max_depth();
+
+    // NOTE: The data stream isn't self synchronizing - payload bytes of
+    // binary atoms can hold any value at all, so there's no telling a
+    // token from data without having walked every header before it.
+    // Headers are walked one at a time; only runs of tiny atoms (one
+    // byte each, and by far the most common item) are picked up many
+    // bytes at a time.
+
+    if (len > UINT32_MAX)
+    {
+        throw topaz_exception("Token stream too large to index");
+    }
+
+    // Start over (storage kept)
+    this->data = data;
+    this->len = len;
+    entries.resize(1);
+    parents.resize(1);
+    children.clear();
+    open.clear();
+    entries[0].size = len;
+    entries[0].count = 0;
+    frame_t top_level = {0, IN_LIST};
+    open.push_back(top_level);
+
+    while (pos < len)
+    {
+        frame_t &top = open.back();
+        byte tok = data[pos];
+
+        // Closing tokens
+        if (top.state == NAME_END)
+        {
+            if (tok != datum::TOK_END_NAME)
+            {
+                throw topaz_exception("Unexpected token in datum encoding");
+            }
+            entries[top.entry].size = pos + 1 - entries[top.entry].offset;
+            open.pop_back();
+            pos++;
+            continue;
+        }
+        if ((tok == datum::TOK_END_LIST) && (top.state == IN_LIST) && (open.size() > 1))
+        {
+            entries[top.entry].size = pos + 1 - entries[top.entry].offset;
+            open.pop_back();
+            pos++;
+            continue;
+        }
+
+        // Name of named value is always an atom
+        if (top.state == NAME_NAME)
+        {
+            size_t size = atom_view(data + pos, len - pos).size();
+            add(pos, size, top.entry);
+            top.state = NAME_VALUE;
+            pos += size;
+            continue;
+        }
+
+        // Value of named value is a single item
+        size_t parent = top.entry;
+        bool single = (top.state == NAME_VALUE);
+        if (single)
+        {
+            top.state = NAME_END;
+        }
+
+        // Tiny atoms (many at once, where allowed)
+        if (tok < atom::SHORT_TOK)
+        {
+            if (single)
+            {
+                add(pos++, 1, parent);
+            }
+            else
+            {
+                pos += add_tiny_run(pos, parent);
+            }
+            continue;
+        }
+
+        // Containers
+        if ((tok == datum::TOK_START_LIST) || (tok == datum::TOK_START_NAME) ||
+            (tok == datum::TOK_CALL))
+        {
+            if (open.size() - 1 >= max_depth)
+            {
+                throw topaz_exception("Datum encoding nested too deeply");
+            }
+            frame_t frame = {(uint32_t)add(pos, 0, parent), IN_LIST};
+            pos++;
+
+            if (tok == datum::TOK_START_NAME)
+            {
+                frame.state = NAME_NAME;
+            }
+            else if (tok == datum::TOK_CALL)
+            {
+                // Object / Method UIDs, then parameter list
+                for (int i = 0; i < 2; i++)
+                {
+                    atom_view uid(data + pos, len - pos);
+                    uid.get_uid();
+                    pos += uid.size();
+                }
+                if ((pos >= len) || (data[pos] != datum::TOK_START_LIST))
+                {
+                    throw topaz_exception("Unexpected token in datum encoding");
+                }
+                pos++;
+            }
+
+            // NOTE: top is invalid after this
+            open.push_back(frame);
+            continue;
+        }
+
+        // Control tokens
+        if (tok == datum::TOK_END_SESSION)
+        {
+            add(pos++, 1, parent);
+        }
+        else if ((tok == datum::TOK_END_OF_DATA) || (tok == datum::TOK_START_TRANS) ||
+                 (tok == datum::TOK_END_TRANS))
+        {
+            // Only found between datums, never within one
+            if (open.size() > 1)
+            {
+                throw topaz_exception("Unexpected token in datum encoding");
+            }
+            add(pos++, 1, parent);
+        }
+        else
+        {
+            // Failing that, it's an atom
+            size_t size = atom_view(data + pos, len - pos).size();
+            add(pos, size, parent);
+            pos += size;
+        }
+    }
+
+    // Everything closed out?
+    if (open.size() > 1)
+    {
+        throw topaz_exception("Datum encoding too short");
+    }
+
+    // Lay out child table, with items of each container side by side
+    size_t next = 0;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        entries[i].first = next;
+        next += entries[i].count;
+        entries[i].count = 0;
+    }
+    children.resize(next);
+    for (size_t i = 1; i < entries.size(); i++)
+    {
+        entry_t &parent = entries[parents[i]];
+        children[parent.first + parent.count++] = i;
+    }
+}
+
+/**
+ * \brief Index buffer of encoded tokens
+ *
+ * @param data Buffer holding encoded tokens (must outlive index)
+ */
+void token_index::build(byte_vector const &data)
+{
+    build((data.empty() ? NULL : &(data[0])), data.size());
+}
+
+/**
+ * \brief Query number of top level items
+ */
+size_t token_index::count() const
+{
+    return entries[0].count;
+}
+
+/**
+ * \brief Query Nth top level item
+ *
+ * @param idx Item to return
+ * @return Entry number of item
+ */
+size_t token_index::root(size_t idx) const
+{
+    return child(0, idx);
+}
+
+/**
+ * \brief Query number of items within container
+ *
+ * @param entry Entry number of container
+ */
+size_t token_index::child_count(size_t entry) const
+{
+    return get_entry(entry).count;
+}
+
+/**
+ * \brief Query Nth item within container
+ *
+ * @param entry Entry number of container
+ * @param idx Item to return
+ * @return Entry number of item
+ */
+size_t token_index::child(size_t entry, size_t idx) const
+{
+    entry_t const &item = get_entry(entry);
+    if (idx >= item.count)
+    {
+        throw topaz_exception("Token index item out of range");
+    }
+    return children[item.first + idx];
+}
+
+/**
+ * \brief Query value of named item within container
+ *
+ * @param entry Entry number of container
+ * @param id Name (unsigned integer) to look for
+ * @return Entry number of named value
+ */
+size_t token_index::find_by_name(size_t entry, uint64_t id) const
+{
+    entry_t const &item = get_entry(entry);
+
+    for (size_t i = 0; i < item.count; i++)
+    {
+        size_t name = children[item.first + i];
+        if (get_token(name) == datum::TOK_START_NAME)
+        {
+            atom_view key = get_atom(child(name, 0));
+            if ((key.get_type() == atom::UINT) && (key.get_uint() == id))
+            {
+                return child(name, 1);
+            }
+        }
+    }
+
+    throw topaz_exception("Named value not present in list");
+}
+
+/**
+ * \brief Query position / size of entry
+ */
+token_index::entry_t const &token_index::get_entry(size_t entry) const
+{
+    if (entry >= entries.size())
+    {
+        throw topaz_exception("Invalid token index entry");
+    }
+    return entries[entry];
+}
+
+/**
+ * \brief Query first byte (token or atom header) of entry
+ */
+byte token_index::get_token(size_t entry) const
+{
+    return data[get_entry(entry).offset];
+}
+
+/**
+ * \brief Query entry as datum (in place)
+ */
+datum_view token_index::get_datum(size_t entry) const
+{
+    entry_t const &item = get_entry(entry);
+    return datum_view(data + item.offset, item.size);
+}
+
+/**
+ * \brief Query entry as atom (in place)
+ */
+atom_view token_index::get_atom(size_t entry) const
+{
+    entry_t const &item = get_entry(entry);
+    return atom_view(data + item.offset, item.size);
+}
+
+/**
+ * \brief Record new entry
+ *
+ * @param offset Byte offset of item
+ * @param size Bytes of item
+ * @param parent Entry number of containing item
+ * @return Entry number of new item
+ */
+size_t token_index::add(size_t offset, size_t size, size_t parent)
+{
+    entry_t item = {(uint32_t)offset, (uint32_t)size, 0, 0};
+    entries.push_back(item);
+    parents.push_back(parent);
+    entries[parent].count++;
+    return entries.size() - 1;
+}
+
+/**
+ * \brief Record run of tiny atoms
+ *
+ * @param pos Byte offset of first tiny atom
+ * @param parent Entry number of containing item
+ * @return Number of tiny atoms recorded
+ */
+size_t token_index::add_tiny_run(size_t pos, size_t parent)
+{
+    size_t end = pos;
+    unsigned mask = 0;
+
+    // Tiny atoms are the only items with top bit clear, so a run of them
+    // is just a run of bytes with no sign bits set.
+#if defined(__AVX2__)
+    while (!mask && (end + 32 <= len))
+    {
+        mask = _mm256_movemask_epi8(_mm256_loadu_si256((__m256i const *)(data + end)));
+        end += (mask ? __builtin_ctz(mask) : 32);
+    }
+#endif
+#if defined(__SSE2__)
+    while (!mask && (end + 16 <= len))
+    {
+        mask = _mm_movemask_epi8(_mm_loadu_si128((__m128i const *)(data + end)));
+        end += (mask ? __builtin_ctz(mask) : 16);
+    }
+#endif
+    if (!mask)
+    {
+        // Tail (or no SIMD at all)
+        while ((end < len) && (data[end] < atom::SHORT_TOK))
+        {
+            end++;
+        }
+    }
+
+    // One entry each
+    for (size_t i = pos; i < end; i++)
+    {
+        add(i, 1, parent);
+    }
+    return end - pos;
+}
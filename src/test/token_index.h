@@ -0,0 +1,196 @@
+#ifndef TOPAZ_TOKEN_INDEX_H
+#define TOPAZ_TOKEN_INDEX_H
+
+/**
+ * Topaz - Token Index
+ *
+ * This class makes one pass over an encoded token stream, checking its
+ * framing and recording where every item starts and ends. Afterwards,
+ * the Nth item of any list (or the value of any named column) can be
+ * found directly, without walking over everything before it.
+ *
+ * Copyright (c) 2014, T Parys
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <vector>
+#include <topaz/atom_view.h>
+#include <topaz/datum_view.h>
+#include <topaz/defs.h>
+
+namespace topaz
+{
+
+    class token_index
+    {
+
+      public:
+
+        // One indexed item (atom, list, named value, method call, or token)
+        typedef struct
+        {
+            uint32_t offset;  // Byte offset of item within buffer
+            uint32_t size;    // Bytes of item (containers: through closing token)
+            uint32_t first;   // Containers: position of first child in child table
+            uint32_t count;   // Containers: number of children
+        } entry_t;
+
+        /**
+         * \brief Constructor
+         */
+        token_index();
+
+        /**
+         * \brief Index buffer of encoded tokens
+         *
+         * Top level items may be datums, or the control tokens found in
+         * method responses (End of Data, transactions). Anything else
+         * throws, as does data nested deeper than datum decoding allows.
+         *
+         * @param data Location of encoded tokens (must outlive index)
+         * @param len  Length of buffer
+         */
+        void build(byte const *data, size_t len);
+
+        /**
+         * \brief Index buffer of encoded tokens
+         *
+         * @param data Buffer holding encoded tokens (must outlive index)
+         */
+        void build(byte_vector const &data);
+
+        /**
+         * \brief Query number of top level items
+         */
+        size_t count() const;
+
+        /**
+         * \brief Query Nth top level item
+         *
+         * @param idx Item to return
+         * @return Entry number of item
+         */
+        size_t root(size_t idx) const;
+
+        /**
+         * \brief Query number of items within container
+         *
+         * Lists and method calls count their items (method parameters),
+         * named values count two (name, value).
+         *
+         * @param entry Entry number of container
+         */
+        size_t child_count(size_t entry) const;
+
+        /**
+         * \brief Query Nth item within container
+         *
+         * @param entry Entry number of container
+         * @param idx Item to return
+         * @return Entry number of item
+         */
+        size_t child(size_t entry, size_t idx) const;
+
+        /**
+         * \brief Query value of named item within container
+         *
+         * @param entry Entry number of container
+         * @param id Name (unsigned integer) to look for
+         * @return Entry number of named value
+         */
+        size_t find_by_name(size_t entry, uint64_t id) const;
+
+        /**
+         * \brief Query position / size of entry
+         */
+        entry_t const &get_entry(size_t entry) const;
+
+        /**
+         * \brief Query first byte (token or atom header) of entry
+         */
+        byte get_token(size_t entry) const;
+
+        /**
+         * \brief Query entry as datum (in place)
+         */
+        datum_view get_datum(size_t entry) const;
+
+        /**
+         * \brief Query entry as atom (in place)
+         */
+        atom_view get_atom(size_t entry) const;
+
+      protected:
+
+        // What an open container expects next
+        typedef enum
+        {
+            IN_LIST,    // List items, until end of list
+            NAME_NAME,  // Name of named value
+            NAME_VALUE, // Value of named value
+            NAME_END    // End of name
+        } state_t;
+
+        // Open container
+        typedef struct
+        {
+            uint32_t entry;
+            state_t  state;
+        } frame_t;
+
+        /**
+         * \brief Record new entry
+         *
+         * @param offset Byte offset of item
+         * @param size Bytes of item
+         * @param parent Entry number of containing item
+         * @return Entry number of new item
+         */
+        size_t add(size_t offset, size_t size, size_t parent);
+
+        /**
+         * \brief Record run of tiny atoms
+         *
+         * @param pos Byte offset of first tiny atom
+         * @param parent Entry number of containing item
+         * @return Number of tiny atoms recorded
+         */
+        size_t add_tiny_run(size_t pos, size_t parent);
+
+        // Indexed data
+        byte const *data;
+        size_t len;
+
+        // Entry 0 holds the top level items
+        std::vector<entry_t>  entries;
+        std::vector<uint32_t> parents;
+        std::vector<uint32_t> children;
+
+        // Containers open during build()
+        std::vector<frame_t> open;
+
+    };
+
+};
+
+#endif
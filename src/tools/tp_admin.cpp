@@ -106,9 +106,11 @@ int main(int argc, char **argv)
     // Open the device
     try
     {
-        // Open the device, start as anonymous mode
+        // Open the device, start as anonymous read-only mode
+        // (commands needing more will log in again with write access)
         drive target(argv[optind]);
-        target.login_anon(ADMIN_SP);
+        target.login_anon(ADMIN_SP, false);
+        target.set_get_cache(true);
 
         // Determine our operation
 
@@ -270,15 +272,10 @@ void do_auth_login(drive &target, string pin, bool pin_valid)
 
     // Failing that, try the default PIN
     pin = target.default_pin();
-    try
+    if (target.try_login(ADMIN_SP, SID, pin) == datum::STA_SUCCESS)
     {
-        target.login(ADMIN_SP, SID, pin);
         return;
     }
-    catch (topaz_exception &e)
-    {
-        // Didn't work
-    }
 
     // Last effort - prompt user for PIN to use ...
     pin = pin_from_console("SID(admin)");
@@ -41,17 +41,22 @@
 #include <topaz/uid.h>
 #include <topaz/pin_entry.h>
 #include <topaz/spinner.h>
+#include <topaz/table_iter.h>
+#include <topaz/transaction.h>
 using namespace std;
 using namespace topaz;
 
 void usage();
 bool require_args(int min, int passed);
+bool is_query_cmd(char const *cmd);
 uint64_t range_id_to_uid(uint64_t id);
 char const *key_uid_to_str(uint64_t uid);
 char const *key_mode_to_str(uint64_t mode);
 uint64_t get_uid(char const *user_str);
 uint64_t get_max_lba_ranges(drive &target);
 void query_acct(drive &target, uint64_t uid, char const *name, int num);
+void print_acct(datum const &row, char const *name, int num);
+bool list_accts(drive &target);
 void query_range(drive &target, uint64_t id);
 void lock_ctl(drive &target, uint64_t id, bool on_reset, bool rd_lock, bool wr_lock);
 void range_ctl(drive &target, uint64_t id, uint64_t first, uint64_t last);
@@ -133,8 +138,12 @@ int main(int argc, char **argv)
             cur_pin = pin_from_console("current");
         }
 
-        // Login
-        target.login(LOCKING_SP, user_uid, cur_pin);
+        // Login (query only commands get a read-only session)
+        target.login(LOCKING_SP, user_uid, cur_pin,
+                     !is_query_cmd(argv[optind + 1]));
+
+        // Avoid re-reading the same values over and over
+        target.set_get_cache(true);
 
         ////
         // Determine our operation
@@ -160,6 +169,14 @@ int main(int argc, char **argv)
         {
             uint64_t i;
 
+            // Walk the Authority table, if we're allowed
+            if (list_accts(target))
+            {
+                return 0;
+            }
+
+            // Otherwise probe every possible account
+
             // Current admin accounts
             for (i = 1; i <= target.get_max_admins(); i++)
             {
@@ -412,6 +429,14 @@ bool require_args(int min, int passed)
     }
 }
 
+bool is_query_cmd(char const *cmd)
+{
+    // Commands which only read from the drive
+    return ((strcmp(cmd, "users") == 0) ||
+            (strcmp(cmd, "ranges") == 0) ||
+            (strcmp(cmd, "ds_read") == 0));
+}
+
 uint64_t range_id_to_uid(uint64_t id)
 {
     if (id == 0)
@@ -506,6 +531,12 @@ uint64_t get_max_lba_ranges(drive &target)
 }
 
 void query_acct(drive &target, uint64_t uid, char const *name, int num)
+{
+    // Common name(2) through Enabled(5)
+    print_acct(target.table_get(uid, 2, 5), name, num);
+}
+
+void print_acct(datum const &row, char const *name, int num)
 {
     atom col;
 
@@ -513,11 +544,11 @@ void query_acct(drive &target, uint64_t uid, char const *name, int num)
     cout << name << num << '\t';
 
     // Enabled/Disabled
-    col = target.table_get(uid, 5);
+    col = row.find_by_name(5).value();
     cout << (col.get_uint() ? "Enabled  " : "Disabled ");
 
     // Common name
-    col = target.table_get(uid, 2);
+    col = row.find_by_name(2).value();
     if ((col.get_type() == atom::BYTES) && (col.size() != 0))
     {
         col.print();
@@ -525,12 +556,63 @@ void query_acct(drive &target, uint64_t uid, char const *name, int num)
     cout << endl;
 }
 
+bool list_accts(drive &target)
+{
+    datum_vector admins, users;
+    vector<uint64_t> admin_ids, user_ids;
+
+    // Authority rows present, with Common name(2) through Enabled(5)
+    try
+    {
+        table_iter iter(target, AUTHORITY_TABLE, 2, 5);
+        while (iter.next())
+        {
+            uint64_t uid = iter.get_uid();
+
+            // Only interested in individual admins & users
+            if ((uid > ADMIN_BASE) && (uid < ADMIN_BASE + 0x10000))
+            {
+                admins.push_back(iter.get_row());
+                admin_ids.push_back(uid - ADMIN_BASE);
+            }
+            else if ((uid > USER_BASE) && (uid < USER_BASE + 0x10000))
+            {
+                users.push_back(iter.get_row());
+                user_ids.push_back(uid - USER_BASE);
+            }
+        }
+    }
+    catch (topaz_exception &e)
+    {
+        // Next[] or Get[] not permitted for this authority
+        return false;
+    }
+
+    // Admins first, then users
+    for (size_t i = 0; i < admins.size(); i++)
+    {
+        print_acct(admins[i], "admin", admin_ids[i]);
+    }
+    for (size_t i = 0; i < users.size(); i++)
+    {
+        print_acct(users[i], "user", user_ids[i]);
+    }
+
+    return true;
+}
+
 void query_range(drive &target, uint64_t id)
 {
     uint64_t key_uid, key_mode, start, size, last;
+    locking_range_t range;
 
     // Query LBA_Range table
-    datum table = target.table_get(range_id_to_uid(id));
+    target.table_get_row(range_id_to_uid(id), range);
+
+    // Every column shown below must have come back (Start, Length,
+    // lock enables, locks, and ActiveKey)
+    static uint64_t const cols[] = {3, 4, 5, 6, 7, 8, 10};
+    schema_require(range, cols, sizeof(cols) / sizeof(cols[0]));
 
     // Range ID
     cout << (int)id;
@@ -539,7 +621,7 @@ void query_range(drive &target, uint64_t id)
     cout << '\t';
 
     // Key type
-    key_uid = table.find_by_name(10).value().get_uid();
+    key_uid = range.active_key;
     cout << key_uid_to_str(key_uid) << '\t';
 
     // Block cipher mode
@@ -554,10 +636,10 @@ void query_range(drive &target, uint64_t id)
     }
 
     // Read Lock State
-    if (table.find_by_name(5).value().get_uint())
+    if (range.read_lock_enabled)
     {
         // Read lock is enabled
-        if (table.find_by_name(7).value().get_uint())
+        if (range.read_locked)
         {
             // And is currently on
             cout << 'R';
@@ -575,10 +657,10 @@ void query_range(drive &target, uint64_t id)
     }
 
     // Write Lock State
-    if (table.find_by_name(6).value().get_uint())
+    if (range.write_lock_enabled)
     {
         // Write lock is enabled
-        if (table.find_by_name(8).value().get_uint())
+        if (range.write_locked)
         {
             // And is currently on
             cout << 'W';
@@ -597,8 +679,8 @@ void query_range(drive &target, uint64_t id)
     cout << '\t';
 
     // Start(3) and Size(4) of LBA Range
-    start = table.find_by_name(3).value().get_uint();
-    size  = table.find_by_name(4).value().get_uint();
+    start = range.range_start;
+    size  = range.range_length;
 
     // Figure out last sector of range
     last = (size ? start + size - 1 : 0);
@@ -631,18 +713,28 @@ void lock_ctl(drive &target, uint64_t id, bool on_reset, bool rd_lock, bool wr_l
         col_base = 7;
     }
 
-    // Enable locks
-    target.table_set(range_id_to_uid(id), col_base + 0, rd_lock);
-    target.table_set(range_id_to_uid(id), col_base + 1, wr_lock);
+    // Enable locks (both, or neither)
+    transaction trans(target);
+    trans.set(range_id_to_uid(id), col_base + 0, (uint64_t)rd_lock);
+    trans.set(range_id_to_uid(id), col_base + 1, (uint64_t)wr_lock);
+    if (trans.commit() != datum::STA_SUCCESS)
+    {
+        throw topaz_exception("Method call failed");
+    }
 }
 
 void range_ctl(drive &target, uint64_t id, uint64_t first, uint64_t last)
 {
     uint64_t size = last + 1 - first;
 
-    // Set range boundaries
-    target.table_set(range_id_to_uid(id), 3, first);
-    target.table_set(range_id_to_uid(id), 4, size);
+    // Set range boundaries (no half moved range left behind on failure)
+    transaction trans(target);
+    trans.set(range_id_to_uid(id), 3, first);
+    trans.set(range_id_to_uid(id), 4, size);
+    if (trans.commit() != datum::STA_SUCCESS)
+    {
+        throw topaz_exception("Method call failed");
+    }
 }
 
 void wipe_range(drive &target, uint64_t id)
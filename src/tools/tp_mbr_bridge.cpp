@@ -29,13 +29,20 @@
  */
 
 #include <unistd.h>
+#define __STDC_FORMAT_MACROS
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <stdint.h>
 #include <string.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <pthread.h>
 #include <signal.h>
 #include <sys/ioctl.h>
@@ -60,9 +67,48 @@ using namespace topaz;
 #define RAMDISK_MB 128
 
 #define MAX_FD(x, y) ((x) > (y) ? (x) : (y))
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+#define MAX(x, y) ((x) > (y) ? (x) : (y))
+
+// Block sizes the NBD driver accepts
+#define MIN_BLK_SIZE 512
+#define MAX_BLK_SIZE 4096
+
+// Smallest request size limit block layer accepts (one page, KiB)
+#define MIN_QUEUE_KB 4
+
+// Dirty data held before writing back to drive (KiB)
+#define WRITE_CACHE_KB 4096
+
+// Clean data kept for further reads (KiB)
+#define READ_CACHE_KB 16384
+
+// Request type telling a pipeline stage to finish up
+#define IO_STOP 0xffffffff
 
 /* structures */
 
+// NBD request on its way through the pipeline
+typedef struct
+{
+    uint32_t type;
+    uint64_t from;
+    uint32_t len;
+    char handle[8];
+    vector<topaz::byte> data;   // write payload, or read result
+    uint32_t error;
+
+} io_req_t;
+
+// Requests handed between pipeline stages
+typedef struct
+{
+    list<io_req_t*> items;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+
+} io_queue_t;
+
 typedef struct
 {
     string nbd_dev;
@@ -76,8 +122,54 @@ typedef struct
     pthread_t kthread;  // kernel thread
     bool kthread_ok;    // thread started?
 
+    uint64_t write_cache_max; // dirty bytes before write back
+    uint64_t read_cache_max;  // bytes of clean chunks kept
+
+    io_queue_t requests;  // socket -> drive
+    io_queue_t replies;   // drive -> socket
+    pthread_t reader;     // parses requests off socket
+    pthread_t writer;     // sends replies to socket
+    bool reader_ok;       // threads started?
+    bool writer_ok;
+
 } prog_state_t;
 
+// Write-back cache of MBR shadow. Extents never overlap or touch, as
+// each write is merged with any neighbors, newest data winning.
+typedef struct
+{
+    map<uint64_t, vector<topaz::byte> > dirty; // Start offset -> data
+    uint64_t dirty_bytes;
+    uint64_t dirty_max;   // write back at this many dirty bytes
+    uint64_t size;        // MBR shadow size
+    uint64_t gran;        // Set[] alignment
+
+    uint64_t writes;      // NBD writes absorbed
+    uint64_t flushes;     // write backs
+    uint64_t sets;        // extents written back
+
+} write_cache_t;
+
+// LRU read cache of MBR shadow, in whole transfer (max_token) chunks.
+// Cached chunks are kept current with writes (dirty or not).
+typedef pair<uint64_t, vector<topaz::byte> > chunk_t; // Chunk number, data
+typedef struct
+{
+    list<chunk_t> lru;                                      // Most recent first
+    unordered_map<uint64_t, list<chunk_t>::iterator> index; // Chunk number -> entry
+    uint64_t max_chunks;  // chunks kept (0 disables cache)
+    uint64_t chunk;       // chunk size
+    uint64_t size;        // MBR shadow size
+
+    uint64_t next_read;   // where a sequential read would pick up
+    int64_t prefetch;     // chunk to read ahead, or -1
+
+    uint64_t hits;        // chunks found in cache
+    uint64_t misses;      // chunks read from drive
+    uint64_t prefetches;  // chunks read ahead
+
+} read_cache_t;
+
 /* lone global for signal handler */
 int kill_fd = -1;
 
@@ -88,6 +180,30 @@ int start_kern_process(int nbd, int sock, pthread_t *thread);
 void *kern_thread(void *ptr);
 void set_sig_handler(void (*handler)(int));
 void sig_handler(int sig);
+void block_signals(sigset_t *old);
+int send_all(int fd, void const *data, size_t len);
+uint64_t pick_blk_size(uint64_t write_gran, uint64_t access_gran);
+void set_queue_limit(string const &nbd_dev, char const *name, uint64_t val);
+int start_pipeline(prog_state_t *state);
+void stop_pipeline(prog_state_t *state);
+void *request_thread(void *ptr);
+void *reply_thread(void *ptr);
+void queue_init(io_queue_t *queue);
+void queue_push(io_queue_t *queue, io_req_t *req);
+io_req_t *queue_pop(io_queue_t *queue);
+bool queue_empty(io_queue_t *queue);
+void cache_write(drive &target, write_cache_t *cache, uint64_t from,
+                 topaz::byte const *data, uint64_t len);
+void cache_overlay(write_cache_t *cache, uint64_t from,
+                   topaz::byte *data, uint64_t len);
+void cache_flush(drive &target, write_cache_t *cache);
+void cache_read(drive &target, read_cache_t *rcache, write_cache_t *wcache,
+                uint64_t from, topaz::byte *data, uint64_t len);
+void cache_update(read_cache_t *rcache, uint64_t from,
+                  topaz::byte const *data, uint64_t len);
+void cache_prefetch(drive &target, read_cache_t *rcache, write_cache_t *wcache);
+vector<topaz::byte> &cache_chunk(drive &target, read_cache_t *rcache,
+                                 write_cache_t *wcache, uint64_t num, bool *hit);
 
 int main(int argc, char **argv)
 {
@@ -105,13 +221,19 @@ int main(int argc, char **argv)
     state.nbd = -1;
     memset(&state.kthread, 0, sizeof(state.kthread));
     state.kthread_ok = false;
+    queue_init(&state.requests);
+    queue_init(&state.replies);
+    state.reader_ok = false;
+    state.writer_ok = false;
 
     // defaults
     state.nbd_dev = "/dev/nbd0";
+    state.write_cache_max = WRITE_CACHE_KB * 1024;
+    state.read_cache_max = READ_CACHE_KB * 1024;
 
     // Process command line switches */
     opterr = 0;
-    while ((c = getopt (argc, argv, "p:P:n:v")) != -1)
+    while ((c = getopt (argc, argv, "p:P:n:w:r:v")) != -1)
     {
         switch (c)
         {
@@ -129,12 +251,21 @@ int main(int argc, char **argv)
                 state.nbd_dev = optarg;
                 break;
 
+            case 'w':
+                state.write_cache_max = strtoull(optarg, NULL, 0) * 1024;
+                break;
+
+            case 'r':
+                state.read_cache_max = strtoull(optarg, NULL, 0) * 1024;
+                break;
+
             case 'v':
                 topaz_debug++;
                 break;
 
             default:
-                if ((optopt == 'p') || (optopt == 'P') || (optopt == 'n'))
+                if ((optopt == 'p') || (optopt == 'P') || (optopt == 'n') ||
+                    (optopt == 'w') || (optopt == 'r'))
                 {
                     cerr << "Option -" << optopt << " requires an argument." << endl;
                 }
@@ -182,13 +313,13 @@ int main(int argc, char **argv)
 
 int main2(prog_state_t *state)
 {
-    uint64_t mbr_shadow_size = 128 * 1024 * 1024; // Min size for now
+    uint64_t mbr_shadow_size = 128 * 1024 * 1024; // Min size (until told otherwise)
+    uint64_t write_gran = 0, access_gran = 0, blk_size, xfer_size;
     uint64_t user_uid = ADMIN_BASE + 1;
-    struct nbd_request request;
-    struct nbd_reply reply;
-    int max_fd, rc = 0;
-    fd_set fds;
-    vector<topaz::byte> buffer;
+    io_req_t *req = NULL;
+    int rc = 1;
+    write_cache_t wcache;
+    read_cache_t rcache;
 
     ////
     // First set up the NBD device ...
@@ -213,23 +344,6 @@ int main2(prog_state_t *state)
         return 1;
     }
 
-    // set up NBD
-    if ((ioctl(state->nbd, NBD_SET_SIZE, mbr_shadow_size) == -1) ||
-        (ioctl(state->nbd, NBD_SET_BLKSIZE, 4096) == -1) ||
-        (ioctl(state->nbd, NBD_CLEAR_SOCK) == -1))
-    {
-        perror("NBD setup failed");
-        return 1;
-    }
-
-    // set up kernel thread
-    if (start_kern_process(state->nbd, state->kern_pipe[1], &(state->kthread)))
-    {
-        perror("Cannot start kernel thread");
-        return 1;
-    }
-    state->kthread_ok = 1;
-
     ////
     // NBD <-> TCG Opal Operations
     //
@@ -241,115 +355,183 @@ int main2(prog_state_t *state)
         drive target(state->drive.c_str());
         target.login(LOCKING_SP, user_uid, state->cur_pin);
 
-        // only need to set this once
-        reply.magic = htobe32(NBD_REPLY_MAGIC);
+        // Size and alignment of MBR shadow, as the drive describes it
+        try
+        {
+            table_desc_t const &desc = target.get_table_desc(MBR_UID);
+            if (desc.rows)
+            {
+                mbr_shadow_size = desc.rows;
+            }
+            else
+            {
+                // Size left blank, stick with default
+                printf("MBR table size unknown, assuming %" PRIu64 " MiB\n",
+                       mbr_shadow_size / (1024 * 1024));
+            }
+            write_gran = desc.write_gran;
+            access_gran = desc.access_gran;
+        }
+        catch (topaz_exception &e)
+        {
+            // No descriptor, stick with defaults
+            printf("Cannot read MBR table descriptor, assuming %" PRIu64 " MiB\n",
+                   mbr_shadow_size / (1024 * 1024));
+        }
+        xfer_size = target.bin_xfer_size(MBR_UID);
+
+        // Kernel block size matches write granularity, if it can
+        blk_size = pick_blk_size(write_gran, access_gran);
+        mbr_shadow_size = mbr_shadow_size / blk_size * blk_size;
+        printf("MBR shadow: %" PRIu64 " bytes, %" PRIu64 " byte blocks, %" PRIu64 " byte transfers\n",
+               mbr_shadow_size, blk_size, xfer_size);
+
+        // set up NBD
+        if ((ioctl(state->nbd, NBD_SET_BLKSIZE, (unsigned long)blk_size) == -1) ||
+            (ioctl(state->nbd, NBD_SET_SIZE, (unsigned long)mbr_shadow_size) == -1) ||
+            (ioctl(state->nbd, NBD_CLEAR_SOCK) == -1))
+        {
+            perror("NBD setup failed");
+            return 1;
+        }
+
+        // Kernel only sends FLUSH when told it may. FUA isn't offered, so
+        // FLUSH is the one point data must be on the drive before the reply.
+        bool can_flush = false;
+#if defined(NBD_SET_FLAGS) && defined(NBD_FLAG_SEND_FLUSH)
+        can_flush = (ioctl(state->nbd, NBD_SET_FLAGS,
+                           (unsigned long)(NBD_FLAG_HAS_FLAGS | NBD_FLAG_SEND_FLUSH)) != -1);
+#endif
+        if (!can_flush && state->write_cache_max)
+        {
+            printf("Kernel won't send flushes, writing through\n");
+        }
+
+        // Largest request (and read ahead) kernel should send is one transfer,
+        // unless that's too small for the kernel to take
+        if (xfer_size / 1024 >= MIN_QUEUE_KB)
+        {
+            set_queue_limit(state->nbd_dev, "max_sectors_kb", xfer_size / 1024);
+            set_queue_limit(state->nbd_dev, "read_ahead_kb", xfer_size / 1024);
+        }
+
+        // set up kernel thread
+        if (start_kern_process(state->nbd, state->kern_pipe[1], &(state->kthread)))
+        {
+            perror("Cannot start kernel thread");
+            return 1;
+        }
+        state->kthread_ok = 1;
+
+        // Writes are held, merged, and written back in whole transfers,
+        // but only if a flush can make the kernel wait for them
+        wcache.dirty_bytes = 0;
+        wcache.dirty_max = (can_flush ? state->write_cache_max : 0);
+        wcache.size = mbr_shadow_size;
+        wcache.gran = (write_gran ? write_gran : 1);
+        wcache.writes = wcache.flushes = wcache.sets = 0;
+
+        // Reads are served from whole transfers, kept around for later
+        rcache.chunk = xfer_size;
+        rcache.max_chunks = state->read_cache_max / rcache.chunk;
+        rcache.size = mbr_shadow_size;
+        rcache.next_read = 0;
+        rcache.prefetch = -1;
+        rcache.hits = rcache.misses = rcache.prefetches = 0;
+
+        // Socket I/O runs in threads of its own, either side of this one
+        if (start_pipeline(state))
+        {
+            perror("Cannot start pipeline threads");
+            throw topaz_exception("Pipeline startup failed");
+        }
 
         // main program loop
         printf("And we're up!\n");
         while (1)
         {
-            // set up select call
-            FD_ZERO(&fds);
-            FD_SET(state->sig_pipe[0], &fds);
-            FD_SET(state->kern_pipe[0], &fds);
-            max_fd = MAX_FD(state->sig_pipe[0], state->kern_pipe[0]);
-
-            // call select()
-            rc = select(max_fd + 1, &fds, NULL, NULL, NULL);
-            if ((rc == -1) && (errno == EINTR))
+            // Next request, in the order the kernel sent them
+            req = queue_pop(&state->requests);
+            if (req->type == IO_STOP)
             {
-                // signal handler probably fired, loop and check
-                continue;
-            }
-            else if (rc < 1)
-            {
-                printf("Unexpected select error (rc=%d)\n", rc);
-                return 1;
+                delete req;
+                req = NULL;
+                break;
             }
-
-            // signal handler telling us it's time?
-            if (FD_ISSET(state->sig_pipe[0], &fds))
+            if (req->type == NBD_CMD_DISC)
             {
-                printf("Caught signal and shutting down ...\n");
-                return 0;
+                // No reply expected, just finish up
+                TOPAZ_DEBUG(1) printf("Disconnect request\n");
+                delete req;
+                req = NULL;
+                break;
             }
 
-            // got something from kernel?
-            if (FD_ISSET(state->kern_pipe[0], &fds))
+            // figure out what the kernel wants ...
+            switch (req->type)
             {
-                // read I/O request from kernel
-                rc = recv(state->kern_pipe[0], &request, sizeof(request), MSG_WAITALL);
-                if (rc < (int)sizeof(request))
-                {
-                    perror("Short read from kernel");
-                    return 1;
-                }
-
-                TOPAZ_DEBUG(1) printf("Got a command!\n");
-
-                // byteflips
-                request.magic = be32toh(request.magic);
-                request.type = be32toh(request.type);
-                request.len = be32toh(request.len);
-                request.from = be64toh(request.from);
-
-                // sanity check
-                if (request.magic != NBD_REQUEST_MAGIC)
-                {
-                    fprintf(stderr, "Invalid NBD magic number");
-                    return 1;
-                }
-
-                // I/O handle
-                memcpy(reply.handle, request.handle, sizeof(request.handle));
-                reply.error = 0;
-
-                // figure out what the kernel wants ...
-                switch (request.type)
-                {
-                    case NBD_CMD_READ:
-                        TOPAZ_DEBUG(1) printf("Request for read of size %d\n", request.len);
-
-                        // Grab the data from the MBR
-                        buffer.resize(request.len);
-                        target.table_get_bin(MBR_UID, request.from, &(buffer[0]), request.len);
-
-                        // Respond
-                        send(state->kern_pipe[0], &reply, sizeof(struct nbd_reply), 0);
-                        send(state->kern_pipe[0], &(buffer[0]), request.len, 0);
-                        break;
-
-                    case NBD_CMD_WRITE:
-                        TOPAZ_DEBUG(1) printf("Request for write of size %d\n", request.len);
-
-                        // Grab data from socket
-                        buffer.resize(request.len);
-                        recv(state->kern_pipe[0], &(buffer[0]), request.len, MSG_WAITALL);
-                        target.table_set_bin(MBR_UID, request.from, &(buffer[0]), request.len);
-
-                        // Respond
-                        send(state->kern_pipe[0], (char*)&reply, sizeof(struct nbd_reply), 0);
+                case NBD_CMD_READ:
+                    TOPAZ_DEBUG(1) printf("Request for read of size %d\n", req->len);
+
+                    // Grab the data from the MBR
+                    req->data.resize(req->len);
+                    if (req->len > 0)
+                    {
+                        cache_read(target, &rcache, &wcache, req->from, &(req->data[0]), req->len);
+                    }
+                    break;
+
+                case NBD_CMD_WRITE:
+                    TOPAZ_DEBUG(1) printf("Request for write of size %d\n", req->len);
+
+                    // Data already pulled off socket (nothing to do when empty)
+                    if (req->len == 0)
+                    {
                         break;
+                    }
+                    cache_update(&rcache, req->from, &(req->data[0]), req->len);
+                    cache_write(target, &wcache, req->from, &(req->data[0]), req->len);
+                    break;
+
+#ifdef NBD_FLAG_SEND_FLUSH
+                case NBD_CMD_FLUSH:
+                    TOPAZ_DEBUG(1) printf("Flush request\n");
+
+                    // Everything written so far goes to drive, then respond
+                    cache_flush(target, &wcache);
+                    break;
+#endif
 
-#ifdef NBD_CMD_FLUSH
-                    case NBD_CMD_FLUSH:
-                        TOPAZ_DEBUG(1) printf("Flush request\n");
+                default:
+                    TOPAZ_DEBUG(1) printf("Invalid / unknown request type %d\n", req->type);
 
-                        // Nothing to do, respond
-                        send(state->kern_pipe[0], (char*)&reply, sizeof(struct nbd_reply), 0);
-                        break;
-#endif
+                    // Respond w/ error
+                    req->error = EINVAL;
+                    break;
+            }
 
-                    default:
-                        TOPAZ_DEBUG(1) printf("Invalid / unknown request type %d\n", request.type);
+            // Respond, once writer gets to it (writer owns it now)
+            queue_push(&state->replies, req);
+            req = NULL;
 
-                        // Respond w/ error
-                        reply.error = htobe32(EINVAL);
-                        send(state->kern_pipe[0], (char*)&reply, sizeof(struct nbd_reply), 0);
-                        break;
-                }
+            // Read ahead (if sequential), unless the kernel is waiting on more
+            if (queue_empty(&state->requests))
+            {
+                cache_prefetch(target, &rcache, &wcache);
             }
         }
+
+        // Shutting down
+        cache_flush(target, &wcache);
+        printf("Write cache: %" PRIu64 " writes, %" PRIu64 " write backs, %" PRIu64 " Set[] extents\n",
+               wcache.writes, wcache.flushes, wcache.sets);
+        if (rcache.hits + rcache.misses)
+        {
+            printf("Read cache: %" PRIu64 " hits, %" PRIu64 " misses (%.1f%% hit), %" PRIu64 " read ahead\n",
+                   rcache.hits, rcache.misses,
+                   100.0 * rcache.hits / (rcache.hits + rcache.misses), rcache.prefetches);
+        }
+        rc = 0;
     }
 
     // Something bad happened ...
@@ -358,7 +540,13 @@ int main2(prog_state_t *state)
         cerr << "Exception raised: " << e.what() << endl;
     }
 
-    return 1;
+    // Request drive was working on when things went wrong
+    delete req;
+
+    // Wind down socket threads
+    stop_pipeline(state);
+
+    return rc;
 }
 
 void usage()
@@ -372,6 +560,8 @@ void usage()
          << "  -p <pin>  - Provide current SID PIN" << endl
          << "  -P <file> - Read current PIN from file" << endl
          << "  -n <dev>  - Choose NBD device (default /dev/nbd0)" << endl
+         << "  -w <KiB>  - Write cache size (default " << WRITE_CACHE_KB << ", 0 to write through)" << endl
+         << "  -r <KiB>  - Read cache size (default " << READ_CACHE_KB << ", 0 to disable)" << endl
          << "  -v        - Increase debug verbosity" << endl;
 }
 
@@ -387,13 +577,17 @@ int start_kern_process(int nbd, int sock, pthread_t *thread)
     args[0] = nbd;
     args[1] = sock;
 
-    /* fire off kernel thread */
+    /* fire off kernel thread (signals are left to main thread) */
+    sigset_t old;
+    block_signals(&old);
     if (pthread_create(thread, NULL, kern_thread, (void*)args))
     {
         /* cleanup */
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
         free(args);
         return 1;
     }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
 
     /* finish initialization */
     ioctl(nbd, NBD_CLEAR_QUE);
@@ -432,6 +626,7 @@ void set_sig_handler(void (*handler)(int))
     struct sigaction action;
     memset(&action, 0, sizeof(action));
     action.sa_handler = handler;
+    action.sa_flags = SA_RESTART; /* drive I/O carries on regardless */
 
     /* install signal handlers */
     sigaction(SIGINT, &action, NULL);  /* control-c at console */
@@ -452,3 +647,550 @@ void sig_handler(int sig)
         exit(0);
     }
 }
+
+// Block shutdown signals in calling thread (and any it starts)
+void block_signals(sigset_t *old)
+{
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    sigaddset(&set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &set, old);
+}
+
+// Send whole buffer, through partial sends and interruptions
+int send_all(int fd, void const *data, size_t len)
+{
+    char const *ptr = (char const*)data;
+    ssize_t rc;
+
+    while (len > 0)
+    {
+        rc = send(fd, ptr, len, MSG_NOSIGNAL);
+        if ((rc == -1) && (errno == EINTR))
+        {
+            continue;
+        }
+        else if (rc < 1)
+        {
+            return -1;
+        }
+        ptr += rc;
+        len -= rc;
+    }
+
+    return 0;
+}
+
+// Hold write in cache, merged with any overlapping / adjacent writes
+void cache_write(drive &target, write_cache_t *cache, uint64_t from,
+                 topaz::byte const *data, uint64_t len)
+{
+    map<uint64_t, vector<topaz::byte> >::iterator iter, first;
+    uint64_t start = from, end = from + len;
+
+    // Empty extents would break merging and flushing
+    if (len == 0)
+    {
+        return;
+    }
+
+    cache->writes++;
+
+    // First extent touching this write (may start before it)
+    first = cache->dirty.upper_bound(from);
+    if (first != cache->dirty.begin())
+    {
+        iter = first;
+        --iter;
+        if (iter->first + iter->second.size() >= from)
+        {
+            first = iter;
+        }
+    }
+
+    // Span of everything this write touches
+    for (iter = first; (iter != cache->dirty.end()) && (iter->first <= from + len); ++iter)
+    {
+        start = MIN(start, iter->first);
+        end = MAX(end, iter->first + iter->second.size());
+    }
+
+    // Older data first, then this write over top
+    vector<topaz::byte> merged(end - start);
+    for (iter = first; (iter != cache->dirty.end()) && (iter->first <= from + len); )
+    {
+        memcpy(&(merged[iter->first - start]), &(iter->second[0]), iter->second.size());
+        cache->dirty_bytes -= iter->second.size();
+        cache->dirty.erase(iter++);
+    }
+    memcpy(&(merged[from - start]), data, len);
+    cache->dirty_bytes += merged.size();
+    cache->dirty[start].swap(merged);
+
+    // Enough held back already?
+    if (cache->dirty_bytes >= cache->dirty_max)
+    {
+        cache_flush(target, cache);
+    }
+}
+
+// Lay cached writes over data read from drive
+void cache_overlay(write_cache_t *cache, uint64_t from,
+                   topaz::byte *data, uint64_t len)
+{
+    map<uint64_t, vector<topaz::byte> >::const_iterator iter;
+
+    // First extent which may overlap read
+    iter = cache->dirty.upper_bound(from);
+    if (iter != cache->dirty.begin())
+    {
+        --iter;
+    }
+
+    for (; (iter != cache->dirty.end()) && (iter->first < from + len); ++iter)
+    {
+        uint64_t start = MAX(from, iter->first);
+        uint64_t end = MIN(from + len, iter->first + iter->second.size());
+        if (start < end)
+        {
+            memcpy(data + (start - from), &(iter->second[start - iter->first]), end - start);
+        }
+    }
+}
+
+// Write back all cached writes, in whole aligned transfers
+void cache_flush(drive &target, write_cache_t *cache)
+{
+    map<uint64_t, vector<topaz::byte> >::const_iterator iter;
+    vector<topaz::byte> aligned;
+
+    if (cache->dirty.empty())
+    {
+        return;
+    }
+    cache->flushes++;
+
+    TOPAZ_DEBUG(1) printf("Writing back %" PRIu64 " bytes in %zu extents\n",
+                          cache->dirty_bytes, cache->dirty.size());
+
+    for (iter = cache->dirty.begin(); iter != cache->dirty.end(); ++iter)
+    {
+        uint64_t start = iter->first, end = start + iter->second.size();
+        uint64_t a_start = start / cache->gran * cache->gran;
+        uint64_t a_end = MIN((end + cache->gran - 1) / cache->gran * cache->gran, cache->size);
+
+        if ((a_start == start) && (a_end <= end))
+        {
+            // Already aligned, straight from cache (split per max_token)
+            target.table_set_bin(MBR_UID, start, &(iter->second[0]), iter->second.size());
+        }
+        else
+        {
+            // Fill out partial blocks at either end from drive
+            aligned.resize(a_end - a_start);
+            if (a_start < start)
+            {
+                target.table_get_bin(MBR_UID, a_start, &(aligned[0]), start - a_start);
+            }
+            if (end < a_end)
+            {
+                target.table_get_bin(MBR_UID, end, &(aligned[end - a_start]), a_end - end);
+            }
+            memcpy(&(aligned[start - a_start]), &(iter->second[0]), iter->second.size());
+            target.table_set_bin(MBR_UID, a_start, &(aligned[0]), aligned.size());
+        }
+        cache->sets++;
+    }
+
+    cache->dirty.clear();
+    cache->dirty_bytes = 0;
+}
+
+// Read from cache, loading any missing chunks from drive
+void cache_read(drive &target, read_cache_t *rcache, write_cache_t *wcache,
+                uint64_t from, topaz::byte *data, uint64_t len)
+{
+    uint64_t num, start, end;
+    bool hit;
+
+    // No cache, straight from drive (plus anything not yet written back)
+    if (rcache->max_chunks == 0)
+    {
+        target.table_get_bin(MBR_UID, from, data, len);
+        cache_overlay(wcache, from, data, len);
+        return;
+    }
+
+    // Copy out of each chunk covering the read
+    for (num = from / rcache->chunk; num * rcache->chunk < from + len; num++)
+    {
+        vector<topaz::byte> &chunk = cache_chunk(target, rcache, wcache, num, &hit);
+        if (hit) rcache->hits++;
+        else     rcache->misses++;
+
+        start = MAX(from, num * rcache->chunk);
+        end = MIN(from + len, num * rcache->chunk + chunk.size());
+        memcpy(data + (start - from), &(chunk[start - num * rcache->chunk]), end - start);
+    }
+
+    // Picking up where the last read left off? Read ahead the next chunk.
+    if ((from == rcache->next_read) && (num * rcache->chunk < rcache->size) &&
+        (rcache->index.find(num) == rcache->index.end()))
+    {
+        rcache->prefetch = num;
+    }
+    rcache->next_read = from + len;
+}
+
+// Keep cached chunks current with write
+void cache_update(read_cache_t *rcache, uint64_t from,
+                  topaz::byte const *data, uint64_t len)
+{
+    unordered_map<uint64_t, list<chunk_t>::iterator>::iterator hit;
+    uint64_t num, start, end;
+
+    if (rcache->max_chunks == 0)
+    {
+        return;
+    }
+
+    for (num = from / rcache->chunk; num * rcache->chunk < from + len; num++)
+    {
+        hit = rcache->index.find(num);
+        if (hit != rcache->index.end())
+        {
+            vector<topaz::byte> &chunk = hit->second->second;
+            start = MAX(from, num * rcache->chunk);
+            end = MIN(from + len, num * rcache->chunk + chunk.size());
+            memcpy(&(chunk[start - num * rcache->chunk]), data + (start - from), end - start);
+        }
+    }
+}
+
+// Read ahead chunk picked out by last sequential read
+void cache_prefetch(drive &target, read_cache_t *rcache, write_cache_t *wcache)
+{
+    bool hit;
+
+    if (rcache->prefetch >= 0)
+    {
+        TOPAZ_DEBUG(1) printf("Reading ahead chunk %" PRId64 "\n", rcache->prefetch);
+        cache_chunk(target, rcache, wcache, rcache->prefetch, &hit);
+        rcache->prefetch = -1;
+        rcache->prefetches++;
+    }
+}
+
+// Find chunk in cache (most recently used now), or load it from drive
+vector<topaz::byte> &cache_chunk(drive &target, read_cache_t *rcache,
+                                 write_cache_t *wcache, uint64_t num, bool *hit)
+{
+    unordered_map<uint64_t, list<chunk_t>::iterator>::iterator iter;
+    uint64_t start = num * rcache->chunk;
+
+    // Already have it
+    iter = rcache->index.find(num);
+    if (iter != rcache->index.end())
+    {
+        rcache->lru.splice(rcache->lru.begin(), rcache->lru, iter->second);
+        *hit = true;
+        return rcache->lru.front().second;
+    }
+    *hit = false;
+
+    // Make room, recycling storage of least recently used chunk
+    if (rcache->index.size() >= rcache->max_chunks)
+    {
+        rcache->index.erase(rcache->lru.back().first);
+        rcache->lru.splice(rcache->lru.begin(), rcache->lru, --rcache->lru.end());
+    }
+    else
+    {
+        rcache->lru.push_front(chunk_t());
+    }
+
+    // One Get[] for the lot (last chunk may be short)
+    chunk_t &entry = rcache->lru.front();
+    entry.first = num;
+    entry.second.resize(MIN(rcache->chunk, rcache->size - start));
+    target.table_get_bin(MBR_UID, start, &(entry.second[0]), entry.second.size());
+    cache_overlay(wcache, start, &(entry.second[0]), entry.second.size());
+    rcache->index[num] = rcache->lru.begin();
+
+    return entry.second;
+}
+
+// Fire off socket reader / writer threads
+int start_pipeline(prog_state_t *state)
+{
+    sigset_t old;
+    int rc = 1;
+
+    // Signals are left to main thread, which the handler expects
+    block_signals(&old);
+    if (pthread_create(&(state->reader), NULL, request_thread, (void*)state) == 0)
+    {
+        state->reader_ok = true;
+        if (pthread_create(&(state->writer), NULL, reply_thread, (void*)state) == 0)
+        {
+            state->writer_ok = true;
+            rc = 0;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    return rc;
+}
+
+// Stop socket reader / writer threads, and drop anything left queued
+void stop_pipeline(prog_state_t *state)
+{
+    char msg = 'X';
+
+    // Reader only waits on socket or signal pipe, so poke the latter
+    if (state->reader_ok)
+    {
+        if (send(state->sig_pipe[1], &msg, sizeof(msg), 0) != sizeof(msg))
+        {
+            perror("Cannot stop request thread");
+        }
+        pthread_join(state->reader, NULL);
+        state->reader_ok = false;
+    }
+
+    // Writer sends everything queued ahead of stop
+    if (state->writer_ok)
+    {
+        io_req_t *stop = new io_req_t;
+        stop->type = IO_STOP;
+        queue_push(&(state->replies), stop);
+        pthread_join(state->writer, NULL);
+        state->writer_ok = false;
+    }
+
+    // Never serviced
+    while (!queue_empty(&(state->requests)))
+    {
+        delete queue_pop(&(state->requests));
+    }
+}
+
+// Socket -> request queue, payloads included
+void *request_thread(void *ptr)
+{
+    prog_state_t *state = (prog_state_t*)ptr;
+    struct nbd_request request;
+    io_req_t *req;
+    int max_fd, rc;
+    fd_set fds;
+
+    while (1)
+    {
+        // set up select call
+        FD_ZERO(&fds);
+        FD_SET(state->sig_pipe[0], &fds);
+        FD_SET(state->kern_pipe[0], &fds);
+        max_fd = MAX_FD(state->sig_pipe[0], state->kern_pipe[0]);
+
+        // call select()
+        rc = select(max_fd + 1, &fds, NULL, NULL, NULL);
+        if ((rc == -1) && (errno == EINTR))
+        {
+            // signal handler probably fired, loop and check
+            continue;
+        }
+        else if (rc < 1)
+        {
+            printf("Unexpected select error (rc=%d)\n", rc);
+            break;
+        }
+
+        // signal handler telling us it's time?
+        if (FD_ISSET(state->sig_pipe[0], &fds))
+        {
+            printf("Caught signal and shutting down ...\n");
+            break;
+        }
+
+        // read I/O request from kernel
+        rc = recv(state->kern_pipe[0], &request, sizeof(request), MSG_WAITALL);
+        if (rc < (int)sizeof(request))
+        {
+            perror("Short read from kernel");
+            break;
+        }
+
+        TOPAZ_DEBUG(1) printf("Got a command!\n");
+
+        // sanity check
+        if (be32toh(request.magic) != NBD_REQUEST_MAGIC)
+        {
+            fprintf(stderr, "Invalid NBD magic number");
+            break;
+        }
+
+        // byteflips
+        req = new io_req_t;
+        req->type = be32toh(request.type);
+        req->len = be32toh(request.len);
+        req->from = be64toh(request.from);
+        req->error = 0;
+        memcpy(req->handle, request.handle, sizeof(request.handle));
+
+        // Grab write data from socket, while drive is busy with earlier requests
+        if ((req->type == NBD_CMD_WRITE) && (req->len > 0))
+        {
+            req->data.resize(req->len);
+            rc = recv(state->kern_pipe[0], &(req->data[0]), req->len, MSG_WAITALL);
+            if (rc < (int)req->len)
+            {
+                perror("Short read from kernel");
+                delete req;
+                break;
+            }
+        }
+
+        queue_push(&(state->requests), req);
+
+        // Nothing follows a disconnect
+        if (req->type == NBD_CMD_DISC)
+        {
+            return NULL;
+        }
+    }
+
+    // Tell drive thread to finish up
+    req = new io_req_t;
+    req->type = IO_STOP;
+    queue_push(&(state->requests), req);
+
+    return NULL;
+}
+
+// Reply queue -> socket
+void *reply_thread(void *ptr)
+{
+    prog_state_t *state = (prog_state_t*)ptr;
+    struct nbd_reply reply;
+    io_req_t *req;
+    bool sock_ok = true;
+
+    // only need to set this once
+    reply.magic = htobe32(NBD_REPLY_MAGIC);
+
+    while (1)
+    {
+        req = queue_pop(&(state->replies));
+        if (req->type == IO_STOP)
+        {
+            delete req;
+            break;
+        }
+
+        // I/O handle
+        memcpy(reply.handle, req->handle, sizeof(req->handle));
+        reply.error = htobe32(req->error);
+
+        // Respond (with data, for successful reads). Once the socket is
+        // gone, replies are just dropped until told to stop.
+        if (sock_ok && send_all(state->kern_pipe[0], &reply, sizeof(struct nbd_reply)))
+        {
+            perror("Cannot send reply to kernel");
+            sock_ok = false;
+        }
+        if (sock_ok && (req->type == NBD_CMD_READ) && (req->error == 0) &&
+            (req->len > 0) && send_all(state->kern_pipe[0], &(req->data[0]), req->len))
+        {
+            perror("Cannot send read data to kernel");
+            sock_ok = false;
+        }
+
+        delete req;
+    }
+
+    return NULL;
+}
+
+// Set up empty queue
+void queue_init(io_queue_t *queue)
+{
+    pthread_mutex_init(&(queue->lock), NULL);
+    pthread_cond_init(&(queue->ready), NULL);
+}
+
+// Add request to tail of queue
+void queue_push(io_queue_t *queue, io_req_t *req)
+{
+    pthread_mutex_lock(&(queue->lock));
+    queue->items.push_back(req);
+    pthread_cond_signal(&(queue->ready));
+    pthread_mutex_unlock(&(queue->lock));
+}
+
+// Take request from head of queue, waiting for one if need be
+io_req_t *queue_pop(io_queue_t *queue)
+{
+    io_req_t *req;
+
+    pthread_mutex_lock(&(queue->lock));
+    while (queue->items.empty())
+    {
+        pthread_cond_wait(&(queue->ready), &(queue->lock));
+    }
+    req = queue->items.front();
+    queue->items.pop_front();
+    pthread_mutex_unlock(&(queue->lock));
+
+    return req;
+}
+
+// Check for waiting requests
+bool queue_empty(io_queue_t *queue)
+{
+    bool empty;
+
+    pthread_mutex_lock(&(queue->lock));
+    empty = queue->items.empty();
+    pthread_mutex_unlock(&(queue->lock));
+
+    return empty;
+}
+
+// Pick kernel block size, ideally matching drive write granularity
+uint64_t pick_blk_size(uint64_t write_gran, uint64_t access_gran)
+{
+    uint64_t gran = MAX(write_gran, access_gran);
+    uint64_t blk_size;
+
+    // Smallest power of two NBD accepts, covering granularity
+    for (blk_size = MIN_BLK_SIZE; (blk_size < gran) && (blk_size < MAX_BLK_SIZE); blk_size *= 2)
+    {
+        // Nada
+    }
+
+    // Odd granularity can't be matched, write back cache fills in the rest
+    if (gran && (blk_size % gran))
+    {
+        printf("Granularity %" PRIu64 " doesn't fit block size %" PRIu64 "\n", gran, blk_size);
+    }
+
+    return blk_size;
+}
+
+// Set block queue limit of NBD device via sysfs (no ioctl for these)
+void set_queue_limit(string const &nbd_dev, char const *name, uint64_t val)
+{
+    string path = "/sys/block/" + nbd_dev.substr(nbd_dev.rfind('/') + 1) + "/queue/" + name;
+    FILE *fp = fopen(path.c_str(), "w");
+
+    if ((fp == NULL) || (fprintf(fp, "%" PRIu64 "\n", val) < 0))
+    {
+        TOPAZ_DEBUG(1) printf("Cannot set %s\n", path.c_str());
+    }
+    if (fp != NULL)
+    {
+        fclose(fp);
+    }
+}
@@ -174,8 +174,11 @@ bool unlock_target(char const *path, uint64_t user_uid, string pin,
         // Subject target
         drive target(path);
 
-        // Login with specified credentials
-        target.login(LOCKING_SP, user_uid, pin);
+        // Login with specified credentials (wrong PIN is no surprise here)
+        if (target.try_login(LOCKING_SP, user_uid, pin) != datum::STA_SUCCESS)
+        {
+            return false;
+        }
 
         // MBR Shadow isn't needed when unlocked, (1 -> hide it)
         target.table_set(MBR_CONTROL, 2, 1);
@@ -104,17 +104,13 @@ int main(int argc, char **argv)
         // Manufactured default SID (MSID) PIN
         if (uid == 0)
         {
-            target.login_anon(ADMIN_SP);
+            target.login_anon(ADMIN_SP, false);
             uid = SID;
             pin = target.default_pin();
         }
 
         // Attempt authenticated login
-        try
-        {
-            target.login(ADMIN_SP, uid, pin);
-        }
-        catch (exception &e)
+        if (target.try_login(ADMIN_SP, uid, pin) != datum::STA_SUCCESS)
         {
             // Failed login
             cerr << "Invalid credentials presented to drive" << endl
@@ -155,7 +151,7 @@ int main(int argc, char **argv)
 
             // If not, SID credentials have been reset to
             // MSID defaults, so get those and continue ...
-            target.login_anon(ADMIN_SP);
+            target.login_anon(ADMIN_SP, false);
             uid = SID;
             pin = target.default_pin();
 
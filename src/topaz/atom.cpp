@@ -33,8 +33,11 @@
 #include <cstdio>
 #include <cstring>
 #include <inttypes.h>
+#include <new>
 #include <topaz/atom.h>
+#include <topaz/atom_view.h>
 #include <topaz/exceptions.h>
+#include <topaz/int_codec.h>
 #include <topaz/portable_endian.h>
 #include <topaz/uid.h>
 using namespace topaz;
@@ -48,15 +51,77 @@ atom::atom()
     data_type = atom::EMPTY;
     data_enc = atom::NONE;
     int_skip = 0;
+    small_len = 0;
     uint_val = 0;
 }
 
+/**
+ * \brief Copy Constructor
+ */
+atom::atom(atom const &ref)
+    : encodable(ref)
+{
+    // Start out empty, then assign
+    small_len = 0;
+    *this = ref;
+}
+
+/**
+ * \brief Move Constructor
+ */
+atom::atom(atom &&ref)
+    : encodable(ref)
+{
+    // Start out empty, then steal
+    small_len = 0;
+    take(ref);
+}
+
 /**
  * \brief Destructor
  */
 atom::~atom()
 {
-    // Nada
+    release();
+}
+
+/**
+ * \brief Assignment Operator
+ */
+atom &atom::operator=(atom const &ref)
+{
+    if (this != &ref)
+    {
+        if (ref.data_type == atom::BYTES)
+        {
+            // Copy payload (inline, if it fits)
+            set_bytes(ref.byte_data(), ref.byte_count());
+        }
+        else
+        {
+            // Integers are plain values
+            release();
+            uint_val = ref.uint_val;
+        }
+        data_type = ref.data_type;
+        data_enc = ref.data_enc;
+        int_skip = ref.int_skip;
+    }
+
+    return *this;
+}
+
+/**
+ * \brief Move Assignment Operator
+ */
+atom &atom::operator=(atom &&ref)
+{
+    if (this != &ref)
+    {
+        take(ref);
+    }
+
+    return *this;
 }
 
 //////////////////////////////////////////////////////////////////
@@ -66,11 +131,6 @@ atom::~atom()
  */
 atom atom::new_int(int64_t value)
 {
-    union
-    {
-        uint64_t flip;
-        byte     raw[8];
-    };
     atom ret;
 
     // Intitialize
@@ -86,26 +146,9 @@ atom atom::new_int(int64_t value)
     }
     else // Determine how many bytes are really needed
     {
-        // Byteflip to big endian
-        flip = htobe64(value);
-
-        // Logic differs a bit based on sign
-        if (value < 0)
-        {
-            // Negative condition is to drop 0xff bytes,
-            // provided the remaining value is still negative
-            // (most significant remaining bit is a 1)
-            for (ret.int_skip = 0; (ret.int_skip < 8) && (raw[ret.int_skip] == 0xff) &&
-                     ((raw[ret.int_skip + 1] & 0x80) == 0x80); ret.int_skip++) {}
-        }
-        else
-        {
-            // Positive condition is to drop 0x00 bytes,
-            // provided the remaining value is still positive
-            // (most significant remaining bit is a 0)
-            for (ret.int_skip = 0; (ret.int_skip < 8) && (raw[ret.int_skip] == 0x00) &&
-                     ((raw[ret.int_skip + 1] & 0x80) == 0x00); ret.int_skip++) {}
-        }
+        // Drop leading 0x00 / 0xff bytes, provided the remaining value
+        // keeps its sign (most significant remaining bit unchanged)
+        ret.int_skip = skip_int_bytes(value);
 
         // All integers less than 16 bytes long (128 bits) will fit in this ...
         ret.data_enc = atom::SHORT;
@@ -119,11 +162,6 @@ atom atom::new_int(int64_t value)
  */
 atom atom::new_uint(uint64_t value)
 {
-    union
-    {
-        uint64_t flip;
-        byte     raw[8];
-    };
     atom ret;
 
     // Intitialize
@@ -139,12 +177,8 @@ atom atom::new_uint(uint64_t value)
     }
     else // Determine how many bytes are really needed
     {
-        // Byteflip to big endian
-        flip = htobe64(value);
-
         // Drop unneeded leading zeroes (up to 7)
-        for (ret.int_skip = 0; (ret.int_skip < 8) && (raw[ret.int_skip] == 0x00);
-             ret.int_skip++) {}
+        ret.int_skip = skip_uint_bytes(value);
 
         // All integers less than 16 bytes long (128 bits) will fit in this ...
         ret.data_enc = atom::SHORT;
@@ -180,12 +214,8 @@ atom atom::new_uid(uint64_t value)
     // Flip integer big endian
     flip = htobe64(value);
 
-    // Now binary
-    ret.bytes.resize(8);
-    for (size_t i = 0; i < 8; i++)
-    {
-        ret.bytes[i] = raw[i];
-    }
+    // Now binary (held inline)
+    ret.set_bytes(raw, 8);
 
     return ret;
 }
@@ -216,12 +246,8 @@ atom atom::new_half_uid(uint32_t value)
     // Flip integer big endian
     flip = htobe32(value);
 
-    // Now binary
-    ret.bytes.resize(4);
-    for (size_t i = 0; i < 4; i++)
-    {
-        ret.bytes[i] = raw[i];
-    }
+    // Now binary (held inline)
+    ret.set_bytes(raw, 4);
 
     return ret;
 }
@@ -240,11 +266,7 @@ atom atom::new_bin(byte const *data, size_t len)
     ret.pick_encoding(len);
 
     // Copy data over
-    ret.bytes.resize(len);
-    for (size_t i = 0; i < len; i++)
-    {
-        ret.bytes[i] = data[i];
-    }
+    ret.set_bytes(data, len);
 
     return ret;
 }
@@ -260,9 +282,85 @@ atom atom::new_bin(char const *str)
 /**
  * \brief Factory Method - Binary Data
  */
-atom atom::new_bin(byte_vector data)
+atom atom::new_bin(byte_vector const &data)
+{
+    return atom::new_bin((data.empty() ? NULL : &(data[0])), data.size());
+}
+
+/**
+ * \brief Factory Method - Binary Data (container taken over)
+ */
+atom atom::new_bin(byte_vector &&data)
+{
+    atom ret;
+
+    // Short payloads are still held inline
+    if (data.size() <= ATOM_INLINE_MAX)
+    {
+        return atom::new_bin(data);
+    }
+
+    // Intialize
+    ret.data_type = atom::BYTES;
+
+    // Pick data encoding
+    ret.pick_encoding(data.size());
+
+    // Adopt caller's container, rather than copying it
+    new (&ret.heap_bytes) byte_vector();
+    ret.heap_bytes.swap(data);
+    ret.small_len = ON_HEAP;
+
+    return ret;
+}
+
+/**
+ * \brief Query header size of binary data fragment
+ *
+ * @param len Length of fragment payload
+ * @return Size of encoded header
+ */
+size_t atom::fragment_header_size(size_t len)
 {
-    return atom::new_bin(&(data[0]), data.size());
+    return (len < 16 ? 1 : (len < 2048 ? 2 : 4));
+}
+
+/**
+ * \brief Encode header of binary data fragment
+ *
+ * Large binary values may be sent as a series of fragments, each
+ * but the last marked as continued. Payload of each fragment is
+ * written by the caller, right after its header.
+ *
+ * @param data Data buffer of at least fragment_header_size() bytes
+ * @param len Length of fragment payload
+ * @param more True if further fragments follow this one
+ * @return Number of bytes encoded
+ */
+size_t atom::encode_fragment_header(byte *data, size_t len, bool more)
+{
+    // Same sizes as atom::pick_encoding()
+    if (len < 16)
+    {
+        data[0] = atom::SHORT_TOK | (more ? atom::SHORT_CONT : atom::SHORT_BIN) | len;
+        return 1;
+    }
+    else if (len < 2048)
+    {
+        data[0] = atom::MEDIUM_TOK | (more ? atom::MEDIUM_CONT : atom::MEDIUM_BIN) | (len >> 8);
+        data[1] = 0xff & len;
+        return 2;
+    }
+    else if (len < 16777216)
+    {
+        data[0] = atom::LONG_TOK | (more ? atom::LONG_CONT : atom::LONG_BIN);
+        data[1] = 0xff & (len >> 16);
+        data[2] = 0xff & (len >> 8);
+        data[3] = 0xff & len;
+        return 4;
+    }
+
+    throw topaz_exception("Atom too large to encode");
 }
 
 /**
@@ -289,19 +387,10 @@ bool atom::operator==(atom const &ref)
 
             case atom::BYTES:
                 // Compare size and bytes
-                if (bytes.size() == ref.bytes.size())
+                if (byte_count() == ref.byte_count())
                 {
-                    // Check each byte
-                    for (size_t i = 0; i < bytes.size(); i++)
-                    {
-                        if (bytes[i] != ref.bytes[i])
-                        {
-                            return false;
-                        }
-                    }
-
-                    // All bytes match
-                    return true;
+                    return ((byte_count() == 0) ||
+                            (memcmp(byte_data(), ref.byte_data(), byte_count()) == 0));
                 }
                 break;
 
@@ -341,7 +430,7 @@ size_t atom::size() const
     else if (data_type == atom::BYTES)
     {
         // Binary data
-        return get_header_size() + bytes.size();
+        return get_header_size() + byte_count();
     }
     else
     {
@@ -384,8 +473,8 @@ size_t atom::encode_bytes(byte *data) const
 
         default: // atom::BYTES:
             // Binary data
-            len = bytes.size();         // Length from container
-            enc_data = &(bytes[0]);     // Pointer to starting byte
+            len = byte_count();         // Length from storage
+            enc_data = byte_data();     // Pointer to starting byte
             break;
     }
 
@@ -466,6 +555,7 @@ size_t atom::encode_bytes(byte *data) const
 size_t atom::decode_bytes(byte const *data, size_t len)
 {
     size_t head_bytes = 0, count = 0;
+    uint8_t bits;
 
     // Minimum 1 byte
     decode_check_size(len, 1);
@@ -489,6 +579,7 @@ size_t atom::decode_bytes(byte const *data, size_t len)
         decode_set_type(0x03 & (data[0] >> 6));
 
         // Must be integer (Note: union type)
+        release();
         int_val = 0x3f & data[0];
         if ((data_type == atom::INT) && (data[0] & 0x20))
         {
@@ -506,7 +597,7 @@ size_t atom::decode_bytes(byte const *data, size_t len)
         head_bytes = 1;
 
         // Determine type
-        decode_set_type(0x03 & (data[0] >> 4));
+        bits = 0x03 & (data[0] >> 4);
 
         // Determine size
         count = data[0] & 0x0f;
@@ -519,7 +610,7 @@ size_t atom::decode_bytes(byte const *data, size_t len)
         decode_check_size(len, head_bytes);
 
         // Determine type
-        decode_set_type(0x03 & (data[0] >> 3));
+        bits = 0x03 & (data[0] >> 3);
 
         // Determine size
         count = 0x07 & data[0];
@@ -533,7 +624,7 @@ size_t atom::decode_bytes(byte const *data, size_t len)
         decode_check_size(len, head_bytes);
 
         // Determine type
-        decode_set_type(0x03 & data[0]);
+        bits = 0x03 & data[0];
 
         // Determine size
         count = data[1];
@@ -546,6 +637,13 @@ size_t atom::decode_bytes(byte const *data, size_t len)
         throw topaz_exception("Cannot parse atom (invalid token)");
     }
 
+    // Binary data continued over several atoms?
+    if (bits == 3)
+    {
+        return decode_continued(data, len);
+    }
+    decode_set_type(bits);
+
     // Ensure expected remaining data is present
     decode_check_size(len, head_bytes + count);
 
@@ -557,12 +655,8 @@ size_t atom::decode_bytes(byte const *data, size_t len)
     }
     else if (data_type == atom::BYTES)
     {
-        // Binary data
-        bytes.resize(count);
-        for (size_t i = 0; i < count; i++)
-        {
-            bytes[i] = data[head_bytes + i];
-        }
+        // Binary data (reuses existing storage when large enough)
+        set_bytes(data + head_bytes, count);
     }
 
     // Final size
@@ -576,7 +670,7 @@ size_t atom::decode_bytes(byte const *data, size_t len)
  */
 atom::type_t atom::get_type() const
 {
-    return data_type;
+    return (atom::type_t)data_type;
 }
 
 /**
@@ -586,7 +680,7 @@ atom::type_t atom::get_type() const
  */
 atom::enc_t atom::get_enc() const
 {
-    return data_enc;
+    return (atom::enc_t)data_enc;
 }
 
 /**
@@ -631,13 +725,13 @@ uint64_t atom::get_uid() const
     // Unique ID's (UIDs) are quirky. They are 64 bit integers, but get
     // encoded like a byte sequence, of a single length 8 (short).
     // This is simultaneously simpler, and infuriating ...
-    if ((data_type != atom::BYTES) || (data_enc != atom::SHORT) || (bytes.size() != 8))
+    if ((data_type != atom::BYTES) || (data_enc != atom::SHORT) || (byte_count() != 8))
     {
         throw topaz_exception("Invalid UID Atom");
     }
 
     // Extract the bytes
-    memcpy(raw, &(bytes[0]), 8);
+    memcpy(raw, byte_data(), 8);
 
     // Flip to native endianess
     return be64toh(flip);
@@ -655,13 +749,13 @@ uint32_t atom::get_half_uid() const
     };
 
     // Unique ID's (Half) are similar to UID's, but stored as 4 byte binary
-    if ((data_type != atom::BYTES) || (data_enc != atom::SHORT) || (bytes.size() != 4))
+    if ((data_type != atom::BYTES) || (data_enc != atom::SHORT) || (byte_count() != 4))
     {
         throw topaz_exception("Invalid UID Atom");
     }
 
     // Extract the bytes
-    memcpy(raw, &(bytes[0]), 4);
+    memcpy(raw, byte_data(), 4);
 
     // Flip to native endianess
     return be32toh(flip);
@@ -698,9 +792,9 @@ int64_t atom::get_int() const
 }
 
 /**
- * \brief Get Binary Data
+ * \brief Get Binary Data (copy)
  */
-byte_vector const &atom::get_bytes() const
+byte_vector atom::get_bytes() const
 {
     // Sanity check
     if (data_type != atom::BYTES)
@@ -708,8 +802,24 @@ byte_vector const &atom::get_bytes() const
         throw topaz_exception("Atom is not binary data");
     }
 
-    // Return reference
-    return bytes;
+    // Copy out, wherever it lives (never touching storage, so const
+    // really is read only)
+    return byte_vector(byte_data(), byte_data() + byte_count());
+}
+
+/**
+ * \brief Get Binary Data (in place)
+ */
+byte_span_t atom::get_span() const
+{
+    // Sanity check
+    if (data_type != atom::BYTES)
+    {
+        throw topaz_exception("Atom is not binary data");
+    }
+
+    byte_span_t span = {byte_data(), byte_count()};
+    return span;
 }
 
 /**
@@ -723,7 +833,7 @@ std::string atom::get_string() const
         throw topaz_exception("Atom is not binary data");
     }
 
-    return std::string(bytes.begin(), bytes.end());
+    return std::string((char const*)byte_data(), byte_count());
 }
 
 /**
@@ -733,6 +843,8 @@ void atom::print() const
 {
     size_t i;
     bool is_print;
+    byte const *bytes = byte_data();
+    size_t count = byte_count();
 
     // Determine what it is ...
     switch (data_type)
@@ -757,7 +869,7 @@ void atom::print() const
 
             // First, check for printable chars
             is_print = true;
-            for (i = 0; i < bytes.size(); i++)
+            for (i = 0; i < count; i++)
             {
                 if (!isprint(bytes[i]))
                 {
@@ -766,11 +878,11 @@ void atom::print() const
             }
 
             // Nonzero length of printable chars are probably strings
-            if ((bytes.size() > 0) && (is_print))
+            if ((count > 0) && (is_print))
             {
                 // Assuming string ...
                 printf("\'");
-                for (i = 0; i < bytes.size(); i++)
+                for (i = 0; i < count; i++)
                 {
                     printf("%c", bytes[i]);
                 }
@@ -778,7 +890,7 @@ void atom::print() const
             }
             // UIDs are two (usually small) numbers, stored together as a uint64.
             // If it looks like two signed or unsigned uint32's, assume UID.
-            else if ((bytes.size() == 8) &&
+            else if ((count == 8) &&
                      ((bytes[0] == 0x00) || (bytes[0] == 0xff)) &&
                      ((bytes[4] == 0x00) || (bytes[4] == 0xff)))
             {
@@ -788,10 +900,16 @@ void atom::print() const
                 printf("%x", (unsigned int)_UID_HIGH(uid));
                 printf(":");
                 printf("%x", (unsigned int)_UID_LOW(uid));
+
+                // Well known ones get a name too
+                if (uid_name(uid))
+                {
+                    printf("(%s)", uid_name(uid));
+                }
             }
             // Half UIDs are UIDs, but half as big, so same thing applies. If it's
             // four bytes, assume a half UID type
-            else if ((bytes.size() == 4) &&
+            else if ((count == 4) &&
                      ((bytes[0] == 0x00) || (bytes[0] == 0xff)))
             {
                 // Assuming Half UID ...
@@ -803,7 +921,7 @@ void atom::print() const
             else
             {
                 printf("[");
-                for (i = 0; (i < 16) && (i < bytes.size()); i++)
+                for (i = 0; (i < 16) && (i < count); i++)
                 {
                     printf("%02X ", bytes[i]);
                 }
@@ -890,41 +1008,184 @@ void atom::decode_set_type(uint8_t bits)
 }
 
 /**
- * \brief Decode unsigned / signed integer
+ * \brief Store binary payload (inline if small enough)
+ *
+ * @param data Payload bytes
+ * @param len  Length of payload
  */
-void atom::decode_int(byte const *data, size_t len)
+void atom::set_bytes(byte const *data, size_t len)
 {
-    union
+    if (small_len == ON_HEAP)
     {
-        uint64_t flip;
-        byte     raw[8];
-    };
+        // Already have a container, reuse it
+        heap_bytes.assign(data, data + len);
+    }
+    else if (len <= ATOM_INLINE_MAX)
+    {
+        // Fits inline
+        if (len)
+        {
+            memcpy(small_bytes, data, len);
+        }
+        small_len = len;
+    }
+    else
+    {
+        // Too big, needs a container
+        new (&heap_bytes) byte_vector(data, data + len);
+        small_len = ON_HEAP;
+    }
+}
+
+/**
+ * \brief Size binary payload storage (inline if small enough)
+ *
+ * @param len Length of payload
+ * @return Location to write payload
+ */
+byte *atom::alloc_bytes(size_t len)
+{
+    if (small_len == ON_HEAP)
+    {
+        // Already have a container, reuse it
+        heap_bytes.resize(len);
+    }
+    else if (len <= ATOM_INLINE_MAX)
+    {
+        // Fits inline
+        small_len = len;
+        return small_bytes;
+    }
+    else
+    {
+        // Too big, needs a container
+        new (&heap_bytes) byte_vector(len);
+        small_len = ON_HEAP;
+    }
+    return (heap_bytes.empty() ? small_bytes : &(heap_bytes[0]));
+}
+
+/**
+ * \brief Decode binary data continued over several atoms
+ *
+ * @param data Location to read encoded bytes
+ * @param len  Length of buffer
+ * @return Number of bytes processed
+ */
+size_t atom::decode_continued(byte const *data, size_t len)
+{
+    atom_view val(data, len); // Checks out all fragments
+    byte_span_t frag;
+    byte *out;
+
+    // Put back together as a single value (so must fit in one atom)
+    data_type = atom::BYTES;
+    pick_encoding(val.get_length());
+    out = alloc_bytes(val.get_length());
+    for (size_t pos = 0; pos < val.size(); )
+    {
+        pos = val.next_fragment(pos, frag);
+        if (frag.len)
+        {
+            memcpy(out, frag.ptr, frag.len);
+            out += frag.len;
+        }
+    }
+
+    return val.size();
+}
+
+/**
+ * \brief Query location of binary payload
+ */
+byte const *atom::byte_data() const
+{
+    if (small_len != ON_HEAP)
+    {
+        return small_bytes;
+    }
+    return (heap_bytes.empty() ? NULL : &(heap_bytes[0]));
+}
+
+/**
+ * \brief Query length of binary payload
+ */
+size_t atom::byte_count() const
+{
+    return (small_len == ON_HEAP ? heap_bytes.size() : small_len);
+}
+
+/**
+ * \brief Drop heap storage, reverting to (empty) inline storage
+ */
+void atom::release()
+{
+    if (small_len == ON_HEAP)
+    {
+        heap_bytes.~byte_vector();
+    }
+    small_len = 0;
+}
 
+/**
+ * \brief Take over contents of another atom, leaving it empty
+ */
+void atom::take(atom &ref)
+{
+    if (ref.small_len == ON_HEAP)
+    {
+        // Swap containers, so payload never gets copied
+        if (small_len != ON_HEAP)
+        {
+            new (&heap_bytes) byte_vector();
+            small_len = ON_HEAP;
+        }
+        heap_bytes.swap(ref.heap_bytes);
+        ref.release();
+    }
+    else
+    {
+        // Inline payload / integers are just bits
+        release();
+        memcpy(small_bytes, ref.small_bytes, ATOM_INLINE_MAX);
+        small_len = ref.small_len;
+    }
+    data_type = ref.data_type;
+    data_enc = ref.data_enc;
+    int_skip = ref.int_skip;
+
+    // Leave other atom empty
+    ref.small_len = 0;
+    ref.data_type = atom::EMPTY;
+    ref.data_enc = atom::NONE;
+    ref.int_skip = 0;
+    ref.uint_val = 0;
+}
+
+/**
+ * \brief Decode unsigned / signed integer
+ */
+void atom::decode_int(byte const *data, size_t len)
+{
     // Sanity check
     if ((len == 0) || (len > 8))
     {
         throw topaz_exception("Invalid integer Atom length");
     }
 
+    // Integer shares storage with binary data
+    release();
+
     // How many bytes don't get set in raw ...
     int_skip = 8 - len;
 
-    // Sign extend negative values
-    if ((data_type == atom::INT) && (data[0] & 0x80))
+    // Big endian load (sign extending negative values)
+    if (data_type == atom::INT)
     {
-        flip = -1; // Unsigned, so 0xfffffffff ....
+        int_val = load_be_int(data, len);
     }
     else
     {
-        flip = 0;
-    }
-
-    // Copy data over
-    for (size_t i = 0; i < len; i++)
-    {
-        raw[int_skip + i] = data[i];
+        uint_val = load_be_uint(data, len);
     }
-
-    // Byteflip (Note: union type)
-    uint_val = be64toh(flip);
 }
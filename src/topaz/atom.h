@@ -36,6 +36,9 @@
 #include <topaz/defs.h>
 #include <topaz/encodable.h>
 
+// Binary payloads up to this size are stored inline (covers SHORT atoms)
+#define ATOM_INLINE_MAX 16
+
 namespace topaz
 {
 
@@ -74,16 +77,19 @@ namespace topaz
             SHORT_TOK   = 0x80,
             SHORT_BIN   = 0x20, // Modifier to SHORT_ATOM
             SHORT_SIGN  = 0x10, // Modifier to SHORT_ATOM
+            SHORT_CONT  = 0x30, // Modifier to SHORT_ATOM (continued binary)
 
             // Medium Atoms
             MEDIUM_TOK  = 0xc0,
             MEDIUM_BIN  = 0x10, // Modifier to MEDIUM_ATOM
             MEDIUM_SIGN = 0x08, // Modifier to MEDIUM_ATOM
+            MEDIUM_CONT = 0x18, // Modifier to MEDIUM_ATOM (continued binary)
 
             // Long Atoms
             LONG_TOK    = 0xe0,
             LONG_BIN    = 0x02, // Modifier to LONG_ATOM
             LONG_SIGN   = 0x01, // Modifier to LONG_ATOM
+            LONG_CONT   = 0x03, // Modifier to LONG_ATOM (continued binary)
 
             // Empty
             EMPTY_TOK   = 0xff
@@ -94,11 +100,31 @@ namespace topaz
          */
         atom();
 
+        /**
+         * \brief Copy Constructor
+         */
+        atom(atom const &ref);
+
+        /**
+         * \brief Move Constructor
+         */
+        atom(atom &&ref);
+
         /**
          * \brief Destructor
          */
         ~atom();
 
+        /**
+         * \brief Assignment Operator
+         */
+        atom &operator=(atom const &ref);
+
+        /**
+         * \brief Move Assignment Operator
+         */
+        atom &operator=(atom &&ref);
+
         /**
          * \brief Factory Method - Unsigned Int
          */
@@ -132,7 +158,34 @@ namespace topaz
         /**
          * \brief Factory Method - Binary Data
          */
-        static topaz::atom new_bin(byte_vector data);
+        static topaz::atom new_bin(byte_vector const &data);
+
+        /**
+         * \brief Factory Method - Binary Data (container taken over)
+         */
+        static topaz::atom new_bin(byte_vector &&data);
+
+        /**
+         * \brief Query header size of binary data fragment
+         *
+         * @param len Length of fragment payload
+         * @return Size of encoded header
+         */
+        static size_t fragment_header_size(size_t len);
+
+        /**
+         * \brief Encode header of binary data fragment
+         *
+         * Large binary values may be sent as a series of fragments, each
+         * but the last marked as continued. Payload of each fragment is
+         * written by the caller, right after its header.
+         *
+         * @param data Data buffer of at least fragment_header_size() bytes
+         * @param len Length of fragment payload
+         * @param more True if further fragments follow this one
+         * @return Number of bytes encoded
+         */
+        static size_t encode_fragment_header(byte *data, size_t len, bool more);
 
         /**
          * \brief Equality Operator
@@ -214,9 +267,16 @@ namespace topaz
         int64_t get_int() const;
 
         /**
-         * \brief Get Binary Data
+         * \brief Get Binary Data (copy)
+         *
+         * Use get_span() to look at the data in place, without copying.
          */
-        byte_vector const &get_bytes() const;
+        byte_vector get_bytes() const;
+
+        /**
+         * \brief Get Binary Data (in place)
+         */
+        byte_span_t get_span() const;
 
         /**
          * \brief Get String
@@ -252,6 +312,51 @@ namespace topaz
          */
         void decode_set_type(uint8_t bits);
 
+        /**
+         * \brief Store binary payload (inline if small enough)
+         *
+         * @param data Payload bytes
+         * @param len  Length of payload
+         */
+        void set_bytes(byte const *data, size_t len);
+
+        /**
+         * \brief Size binary payload storage (inline if small enough)
+         *
+         * @param len Length of payload
+         * @return Location to write payload
+         */
+        byte *alloc_bytes(size_t len);
+
+        /**
+         * \brief Decode binary data continued over several atoms
+         *
+         * @param data Location to read encoded bytes
+         * @param len  Length of buffer
+         * @return Number of bytes processed
+         */
+        size_t decode_continued(byte const *data, size_t len);
+
+        /**
+         * \brief Query location of binary payload
+         */
+        byte const *byte_data() const;
+
+        /**
+         * \brief Query length of binary payload
+         */
+        size_t byte_count() const;
+
+        /**
+         * \brief Drop heap storage, reverting to (empty) inline storage
+         */
+        void release();
+
+        /**
+         * \brief Take over contents of another atom, leaving it empty
+         */
+        void take(atom &ref);
+
         /**
          * \brief Decode unsigned / signed integer
          *
@@ -260,16 +365,21 @@ namespace topaz
          */
         void decode_int(byte const *data, size_t len);
 
-        // Internal Data (raw bytes stored in std::vector superclass)
-        atom::type_t data_type; // What type of data is stored
-        atom::enc_t  data_enc;  // How does it get encoded?
-        size_t int_skip;        // If integer, how many bytes can be skipped
+        // Marks payload as held in heap_bytes, rather than inline
+        static uint8_t const ON_HEAP = 0xff;
+
+        // Internal Data (packed into bytes, as there may be a great many atoms)
+        uint8_t data_type;      // What type of data is stored (atom::type_t)
+        uint8_t data_enc;       // How does it get encoded? (atom::enc_t)
+        uint8_t int_skip;       // If integer, how many bytes can be skipped
+        uint8_t small_len;      // Binary bytes held inline, or ON_HEAP
         union
         {
             uint64_t uint_val;    // Decoded unsigned integer value
             int64_t  int_val;     // Decoded integer value
+            byte small_bytes[ATOM_INLINE_MAX];   // Short binary data
+            byte_vector heap_bytes;              // Longer binary data
         };
-        byte_vector bytes;      // Container for binary bytes
 
     };
 
@@ -0,0 +1,499 @@
+/**
+ * Topaz - Atom View
+ *
+ * This class is a read-only view of an encoded TCG Opal Atom, sitting in a
+ * buffer owned by someone else. Only the header is parsed up front, integer
+ * values are worked out on request, and binary data is never copied. The
+ * view is only valid as long as the underlying buffer.
+ *
+ * Copyright (c) 2014, T Parys
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstring>
+#include <topaz/atom_view.h>
+#include <topaz/exceptions.h>
+#include <topaz/int_codec.h>
+#include <topaz/portable_endian.h>
+using namespace topaz;
+
+/**
+ * \brief Default Constructor (Empty Atom)
+ */
+atom_view::atom_view()
+    : data(NULL), head_size(0), count(0), continued(false), chain_size(0),
+      chain_count(0), data_type(atom::EMPTY), data_enc(atom::NONE)
+{
+    // Nada
+}
+
+/**
+ * \brief Buffer Constructor
+ *
+ * @param data Location of encoded atom
+ * @param len  Length of buffer
+ */
+atom_view::atom_view(byte const *data, size_t len)
+    : data(data), head_size(1), count(0), continued(false), chain_size(0),
+      chain_count(0), data_type(atom::EMPTY), data_enc(atom::NONE)
+{
+    uint8_t bits;
+
+    // Minimum 1 byte
+    if (len < 1)
+    {
+        throw topaz_exception("Atom encoding too short");
+    }
+
+    // Same rules as atom::decode_bytes, minus the copying
+    if (data[0] == atom::EMPTY_TOK)
+    {
+        // Empty Atom (no data)
+        return;
+    }
+    else if (data[0] < atom::SHORT_TOK)
+    {
+        // Tiny Atom (Data stored in header)
+        data_enc = atom::TINY;
+        bits = 0x03 & (data[0] >> 6);
+    }
+    else if (data[0] < atom::MEDIUM_TOK)
+    {
+        // Short Atom (1 byte header)
+        data_enc = atom::SHORT;
+        bits = 0x03 & (data[0] >> 4);
+        count = data[0] & 0x0f;
+    }
+    else if (data[0] < atom::LONG_TOK)
+    {
+        // Medium Atom (2 byte header)
+        data_enc = atom::MEDIUM;
+        head_size = 2;
+        bits = 0x03 & (data[0] >> 3);
+        if (len < head_size)
+        {
+            throw topaz_exception("Atom encoding too short");
+        }
+        count = 0x07 & data[0];
+        count = (count << 8) + data[1];
+    }
+    else if (data[0] < 0xe4)
+    {
+        // Long Atom (4 byte header)
+        data_enc = atom::LONG;
+        head_size = 4;
+        bits = 0x03 & data[0];
+        if (len < head_size)
+        {
+            throw topaz_exception("Atom encoding too short");
+        }
+        count = data[1];
+        count = (count << 8) + data[2];
+        count = (count << 8) + data[3];
+    }
+    else // Reserved, or non-atom token (0xe4 - 0xfe)
+    {
+        throw topaz_exception("Cannot parse atom (invalid token)");
+    }
+
+    // Determine type
+    switch (bits)
+    {
+        case 0:
+            data_type = atom::UINT;
+            break;
+
+        case 1:
+            data_type = atom::INT;
+            break;
+
+        case 2:
+            data_type = atom::BYTES;
+            break;
+
+        default:
+            // Binary data, continued in following atom(s)
+            data_type = atom::BYTES;
+            continued = true;
+            break;
+    }
+
+    // Ensure expected remaining data is present
+    if (len < head_size + count)
+    {
+        throw topaz_exception("Atom encoding too short");
+    }
+
+    // Integers must fit in 64 bits
+    if ((data_enc != atom::TINY) && (data_type != atom::BYTES) &&
+        ((count == 0) || (count > 8)))
+    {
+        throw topaz_exception("Invalid integer Atom length");
+    }
+
+    // Walk remaining fragments, up to the first one not continued
+    if (continued)
+    {
+        atom::enc_t frag_enc;
+        size_t frag_head, frag_count;
+
+        chain_size = head_size + count;
+        chain_count = count;
+        while (bits == 3)
+        {
+            frag_head = read_header(data + chain_size, len - chain_size, frag_enc,
+                                    bits, frag_count);
+            if ((frag_enc == atom::NONE) || (frag_enc == atom::TINY) || (bits < 2))
+            {
+                throw topaz_exception("Continued atom not followed by binary data");
+            }
+            if (len - chain_size < frag_head + frag_count)
+            {
+                throw topaz_exception("Atom encoding too short");
+            }
+            chain_size += frag_head + frag_count;
+            chain_count += frag_count;
+        }
+    }
+}
+
+/**
+ * \brief Query encoded size
+ *
+ * @return Byte count of atom in buffer
+ */
+size_t atom_view::size() const
+{
+    return (continued ? chain_size : head_size + count);
+}
+
+/**
+ * \brief Query Atom Type
+ *
+ * @return Type of atom
+ */
+atom::type_t atom_view::get_type() const
+{
+    return data_type;
+}
+
+/**
+ * \brief Query Atom Encoding
+ *
+ * @return Encoding of atom
+ */
+atom::enc_t atom_view::get_enc() const
+{
+    return data_enc;
+}
+
+/**
+ * \brief Get Unsigned Integer Stored as UID (Bytes)
+ */
+uint64_t atom_view::get_uid() const
+{
+    uint64_t flip;
+
+    // UIDs are 8 byte binary, short encoded
+    if ((data_type != atom::BYTES) || (data_enc != atom::SHORT) || (count != 8))
+    {
+        throw topaz_exception("Invalid UID Atom");
+    }
+
+    // Flip to native endianess
+    memcpy(&flip, data + head_size, 8);
+    return be64toh(flip);
+}
+
+/**
+ * \brief Get Unsigned Integer Stored as Half UID (Bytes)
+ */
+uint32_t atom_view::get_half_uid() const
+{
+    uint32_t flip;
+
+    // Half UIDs are 4 byte binary, short encoded
+    if ((data_type != atom::BYTES) || (data_enc != atom::SHORT) || (count != 4))
+    {
+        throw topaz_exception("Invalid UID Atom");
+    }
+
+    // Flip to native endianess
+    memcpy(&flip, data + head_size, 4);
+    return be32toh(flip);
+}
+
+/**
+ * \brief Get Unsigned Integer Value
+ */
+uint64_t atom_view::get_uint() const
+{
+    // Sanity check
+    if (data_type != atom::UINT)
+    {
+        throw topaz_exception("Atom is not unsigned integer");
+    }
+
+    // Tiny atoms keep value in header
+    if (data_enc == atom::TINY)
+    {
+        return 0x3f & data[0];
+    }
+
+    // Else, big endian payload
+    return load_be_uint(data + head_size, count);
+}
+
+/**
+ * \brief Get Signed Integer Value
+ */
+int64_t atom_view::get_int() const
+{
+    uint64_t val;
+
+    // Sanity check
+    if (data_type != atom::INT)
+    {
+        throw topaz_exception("Atom is not signed integer");
+    }
+
+    // Tiny atoms keep value in header
+    if (data_enc == atom::TINY)
+    {
+        val = 0x3f & data[0];
+        if (data[0] & 0x20)
+        {
+            // Negative signed integer - Sign extend
+            val |= ~(0x3fULL);
+        }
+        return (int64_t)val;
+    }
+
+    // Else, big endian payload (sign extended)
+    return load_be_int(data + head_size, count);
+}
+
+/**
+ * \brief Query if binary data is continued over several atoms
+ */
+bool atom_view::is_continued() const
+{
+    return continued;
+}
+
+/**
+ * \brief Query length of binary data (all fragments)
+ */
+size_t atom_view::get_length() const
+{
+    // Sanity check
+    if (data_type != atom::BYTES)
+    {
+        throw topaz_exception("Atom is not binary data");
+    }
+
+    return (continued ? chain_count : count);
+}
+
+/**
+ * \brief Get Binary Data (in place)
+ *
+ * Continued data isn't contiguous, use next_fragment() instead.
+ */
+byte_span_t atom_view::get_bytes() const
+{
+    // Sanity check
+    if (data_type != atom::BYTES)
+    {
+        throw topaz_exception("Atom is not binary data");
+    }
+    if (continued)
+    {
+        throw topaz_exception("Continued atom must be read by fragment");
+    }
+
+    // Points back into original buffer
+    byte_span_t span = {data + head_size, count};
+    return span;
+}
+
+/**
+ * \brief Get Fragment of Binary Data (in place)
+ *
+ * Walks binary data one atom at a time, starting from an offset
+ * of zero. Uncontinued data is a single fragment.
+ *
+ * @param pos Encoded offset of fragment
+ * @param frag Payload of fragment
+ * @return Encoded offset of next fragment (size() after last)
+ */
+size_t atom_view::next_fragment(size_t pos, byte_span_t &frag) const
+{
+    atom::enc_t frag_enc;
+    size_t frag_head;
+    uint8_t bits;
+
+    // Plain old binary data
+    if (!continued)
+    {
+        if (pos != 0)
+        {
+            throw topaz_exception("No such atom fragment");
+        }
+        frag = get_bytes();
+        return size();
+    }
+
+    // Else, fragments already checked out by constructor
+    if (pos >= chain_size)
+    {
+        throw topaz_exception("No such atom fragment");
+    }
+    frag_head = read_header(data + pos, chain_size - pos, frag_enc, bits, frag.len);
+    frag.ptr = data + pos + frag_head;
+    return pos + frag_head + frag.len;
+}
+
+/**
+ * \brief Get String
+ */
+std::string atom_view::get_string() const
+{
+    byte_span_t span;
+    std::string ret;
+
+    // Usually all in one piece
+    if (!continued)
+    {
+        span = get_bytes();
+        return std::string((char const*)span.ptr, span.len);
+    }
+
+    // Else, continued data gets put back together
+    ret.reserve(chain_count);
+    for (size_t pos = 0; pos < size(); )
+    {
+        pos = next_fragment(pos, span);
+        ret.append((char const*)span.ptr, span.len);
+    }
+    return ret;
+}
+
+/**
+ * \brief Get Encoded Atom (header and payload, in place)
+ */
+byte_span_t atom_view::get_encoded() const
+{
+    byte_span_t span = {data, size()};
+    return span;
+}
+
+/**
+ * \brief Get Copy as Owning Atom
+ */
+atom atom_view::get_atom() const
+{
+    atom ret;
+
+    // Empty view has no buffer to decode
+    if (data)
+    {
+        ret.decode_bytes(data, size());
+    }
+
+    return ret;
+}
+
+/**
+ * \brief Parse atom header
+ *
+ * @param data Location of encoded atom
+ * @param len  Length of buffer
+ * @param enc  Encoding found
+ * @param bits Binary / Sign flags found (values 0-3)
+ * @param count Bytes of payload following header
+ * @return Bytes of header
+ */
+size_t atom_view::read_header(byte const *data, size_t len, atom::enc_t &enc,
+                              uint8_t &bits, size_t &count)
+{
+    // Minimum 1 byte
+    if (len < 1)
+    {
+        throw topaz_exception("Atom encoding too short");
+    }
+
+    bits = 0;
+    count = 0;
+    if (data[0] == atom::EMPTY_TOK)
+    {
+        // Empty Atom (no data)
+        enc = atom::NONE;
+        return 1;
+    }
+    else if (data[0] < atom::SHORT_TOK)
+    {
+        // Tiny Atom (Data stored in header)
+        enc = atom::TINY;
+        bits = 0x03 & (data[0] >> 6);
+        return 1;
+    }
+    else if (data[0] < atom::MEDIUM_TOK)
+    {
+        // Short Atom (1 byte header)
+        enc = atom::SHORT;
+        bits = 0x03 & (data[0] >> 4);
+        count = data[0] & 0x0f;
+        return 1;
+    }
+    else if (data[0] < atom::LONG_TOK)
+    {
+        // Medium Atom (2 byte header)
+        enc = atom::MEDIUM;
+        bits = 0x03 & (data[0] >> 3);
+        if (len < 2)
+        {
+            throw topaz_exception("Atom encoding too short");
+        }
+        count = 0x07 & data[0];
+        count = (count << 8) + data[1];
+        return 2;
+    }
+    else if (data[0] < 0xe4)
+    {
+        // Long Atom (4 byte header)
+        enc = atom::LONG;
+        bits = 0x03 & data[0];
+        if (len < 4)
+        {
+            throw topaz_exception("Atom encoding too short");
+        }
+        count = data[1];
+        count = (count << 8) + data[2];
+        count = (count << 8) + data[3];
+        return 4;
+    }
+
+    // Reserved, or non-atom token (0xe4 - 0xfe)
+    throw topaz_exception("Cannot parse atom (invalid token)");
+}
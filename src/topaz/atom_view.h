@@ -0,0 +1,179 @@
+#ifndef TOPAZ_ATOM_VIEW_H
+#define TOPAZ_ATOM_VIEW_H
+
+/**
+ * Topaz - Atom View
+ *
+ * This class is a read-only view of an encoded TCG Opal Atom, sitting in a
+ * buffer owned by someone else. Only the header is parsed up front, integer
+ * values are worked out on request, and binary data is never copied. The
+ * view is only valid as long as the underlying buffer.
+ *
+ * Copyright (c) 2014, T Parys
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string>
+#include <topaz/defs.h>
+#include <topaz/atom.h>
+
+namespace topaz
+{
+
+    class atom_view
+    {
+
+      public:
+
+        /**
+         * \brief Default Constructor (Empty Atom)
+         */
+        atom_view();
+
+        /**
+         * \brief Buffer Constructor
+         *
+         * @param data Location of encoded atom
+         * @param len  Length of buffer
+         */
+        atom_view(byte const *data, size_t len);
+
+        /**
+         * \brief Query encoded size
+         *
+         * @return Byte count of atom in buffer
+         */
+        size_t size() const;
+
+        /**
+         * \brief Query Atom Type
+         *
+         * @return Type of atom
+         */
+        atom::type_t get_type() const;
+
+        /**
+         * \brief Query Atom Encoding
+         *
+         * @return Encoding of atom
+         */
+        atom::enc_t get_enc() const;
+
+        /**
+         * \brief Get Unsigned Integer Stored as UID (Bytes)
+         */
+        uint64_t get_uid() const;
+
+        /**
+         * \brief Get Unsigned Integer Stored as Half UID (Bytes)
+         */
+        uint32_t get_half_uid() const;
+
+        /**
+         * \brief Get Unsigned Integer Value
+         */
+        uint64_t get_uint() const;
+
+        /**
+         * \brief Get Signed Integer Value
+         */
+        int64_t get_int() const;
+
+        /**
+         * \brief Query if binary data is continued over several atoms
+         */
+        bool is_continued() const;
+
+        /**
+         * \brief Query length of binary data (all fragments)
+         */
+        size_t get_length() const;
+
+        /**
+         * \brief Get Binary Data (in place)
+         *
+         * Continued data isn't contiguous, use next_fragment() instead.
+         */
+        byte_span_t get_bytes() const;
+
+        /**
+         * \brief Get Fragment of Binary Data (in place)
+         *
+         * Walks binary data one atom at a time, starting from an offset
+         * of zero. Uncontinued data is a single fragment.
+         *
+         * @param pos Encoded offset of fragment
+         * @param frag Payload of fragment
+         * @return Encoded offset of next fragment (size() after last)
+         */
+        size_t next_fragment(size_t pos, byte_span_t &frag) const;
+
+        /**
+         * \brief Get String
+         */
+        std::string get_string() const;
+
+        /**
+         * \brief Get Encoded Atom (header and payload, in place)
+         */
+        byte_span_t get_encoded() const;
+
+        /**
+         * \brief Get Copy as Owning Atom
+         */
+        atom get_atom() const;
+
+      protected:
+
+        /**
+         * \brief Parse atom header
+         *
+         * @param data Location of encoded atom
+         * @param len  Length of buffer
+         * @param enc  Encoding found
+         * @param bits Binary / Sign flags found (values 0-3)
+         * @param count Bytes of payload following header
+         * @return Bytes of header
+         */
+        static size_t read_header(byte const *data, size_t len, atom::enc_t &enc,
+                                  uint8_t &bits, size_t &count);
+
+        // Location of encoded atom
+        byte const   *data;      // Start of atom header
+        size_t        head_size; // Bytes of header
+        size_t        count;     // Bytes of payload following header
+
+        // Continued binary data (first fragment described above)
+        bool          continued;
+        size_t        chain_size;  // Bytes of all fragments, headers included
+        size_t        chain_count; // Bytes of payload in all fragments
+
+        // What was found there
+        atom::type_t  data_type;
+        atom::enc_t   data_enc;
+
+    };
+
+};
+
+#endif
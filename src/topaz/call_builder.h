@@ -0,0 +1,682 @@
+#ifndef TOPAZ_CALL_BUILDER_H
+#define TOPAZ_CALL_BUILDER_H
+
+/**
+ * Topaz - Method Call Builder
+ *
+ * Header only builder for SWG method calls. A call is written as a typed
+ * expression, for example:
+ *
+ *   swg::call(tbl_uid, GET, swg::cellblock(swg::start_col(3), swg::end_col(4)))
+ *
+ * and encodes straight into an output buffer, with no datum tree built in
+ * between. Parts whose encoding doesn't depend on run time values report
+ * it as a compile time constant (fixed_size), so calls made up only of
+ * such parts have a known size, and misplaced parts (eg - a UID where a
+ * Cellblock entry belongs) fail to compile.
+ *
+ * Copyright (c) 2014, T Parys
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <type_traits>
+#include <topaz/atom.h>
+#include <topaz/datum.h>
+#include <topaz/exceptions.h>
+#include <topaz/int_codec.h>
+#include <topaz/uid.h>
+
+namespace topaz
+{
+
+    namespace swg
+    {
+
+        //////////////////////////////////////////////////////////////////////////
+        // Building Blocks
+        //
+
+        // Base of anything that can appear in a call
+        struct item {};
+
+        // Base of anything that can appear in a Cellblock
+        struct cell_item : public item {};
+
+        /**
+         * \brief Byte count of unsigned integer, less leading zeroes
+         */
+        inline size_t uint_bytes(uint64_t val)
+        {
+            return (val ? 8 - skip_uint_bytes(val) : 1);
+        }
+
+        /**
+         * \brief Unsigned integer, value known at compile time
+         */
+        template <uint64_t VAL>
+        class uint_const : public item
+        {
+          public:
+
+            // Tiny atoms only, anything else use uint()
+            static_assert(VAL < 0x40, "Compile time integers must fit in a tiny atom");
+            static size_t const fixed_size = 1;
+
+            size_t size() const
+            {
+                return fixed_size;
+            }
+
+            byte *encode(byte *out) const
+            {
+                *out++ = (byte)VAL;
+                return out;
+            }
+        };
+
+        /**
+         * \brief Unsigned integer
+         */
+        class uint_item : public item
+        {
+          public:
+
+            static size_t const fixed_size = 0;
+
+            explicit uint_item(uint64_t val)
+                : val(val)
+            {
+            }
+
+            size_t size() const
+            {
+                return (val < 0x40 ? 1 : 1 + uint_bytes(val));
+            }
+
+            byte *encode(byte *out) const
+            {
+                // Tiny atom
+                if (val < 0x40)
+                {
+                    *out++ = (byte)val;
+                    return out;
+                }
+
+                // Short atom, big endian
+                size_t len = uint_bytes(val);
+                *out++ = atom::SHORT_TOK | len;
+                while (len--)
+                {
+                    *out++ = 0xff & (val >> (8 * len));
+                }
+                return out;
+            }
+
+          protected:
+
+            uint64_t val;
+        };
+
+        /**
+         * \brief Unique ID (always 8 byte binary)
+         */
+        class uid_item : public item
+        {
+          public:
+
+            static size_t const fixed_size = 9;
+
+            explicit uid_item(uint64_t val)
+                : val(val)
+            {
+            }
+
+            size_t size() const
+            {
+                return fixed_size;
+            }
+
+            byte *encode(byte *out) const
+            {
+                memcpy(out, uid_token(val).bytes, sizeof(uid_token_t));
+                return out + sizeof(uid_token_t);
+            }
+
+          protected:
+
+            uint64_t val;
+        };
+
+        /**
+         * \brief Binary data (not copied, must outlive encoding)
+         */
+        class bin_item : public item
+        {
+          public:
+
+            static size_t const fixed_size = 0;
+
+            bin_item(byte const *data, size_t len)
+                : data(data), len(len)
+            {
+                if (len >= 16777216)
+                {
+                    throw topaz_exception("Atom too large to encode");
+                }
+            }
+
+            size_t size() const
+            {
+                return len + (len < 16 ? 1 : (len < 2048 ? 2 : 4));
+            }
+
+            byte *encode(byte *out) const
+            {
+                // Header per atom::pick_encoding()
+                if (len < 16)
+                {
+                    *out++ = atom::SHORT_TOK | atom::SHORT_BIN | len;
+                }
+                else if (len < 2048)
+                {
+                    *out++ = atom::MEDIUM_TOK | atom::MEDIUM_BIN | (len >> 8);
+                    *out++ = 0xff & len;
+                }
+                else
+                {
+                    *out++ = atom::LONG_TOK | atom::LONG_BIN;
+                    *out++ = 0xff & (len >> 16);
+                    *out++ = 0xff & (len >> 8);
+                    *out++ = 0xff & len;
+                }
+
+                // Payload
+                if (len)
+                {
+                    memcpy(out, data, len);
+                }
+                return out + len;
+            }
+
+          protected:
+
+            byte const *data;
+            size_t len;
+        };
+
+        /**
+         * \brief Binary data, written in place as continued fragments
+         *
+         * PRODUCER is called as producer(out, offset, len) to fill in each
+         * fragment of the value straight into the encode buffer, so the
+         * value as a whole never needs to be held anywhere.
+         */
+        template <class PRODUCER>
+        class stream_item : public item
+        {
+          public:
+
+            static size_t const fixed_size = 0;
+
+            stream_item(size_t len, size_t frag_len, PRODUCER const &producer)
+                : len(len), frag_len(frag_len), producer(producer)
+            {
+                if ((frag_len == 0) || (frag_len >= 16777216))
+                {
+                    throw topaz_exception("Invalid atom fragment size");
+                }
+            }
+
+            size_t size() const
+            {
+                size_t full = len / frag_len, part = len % frag_len;
+
+                // Always at least one fragment, even if empty
+                return len + full * atom::fragment_header_size(frag_len) +
+                    ((part || !full) ? atom::fragment_header_size(part) : 0);
+            }
+
+            byte *encode(byte *out) const
+            {
+                size_t offset = 0, frag;
+
+                do
+                {
+                    frag = (len - offset < frag_len ? len - offset : frag_len);
+                    out += atom::encode_fragment_header(out, frag, offset + frag < len);
+                    if (frag)
+                    {
+                        producer(out, offset, frag);
+                    }
+                    out += frag;
+                    offset += frag;
+                }
+                while (offset < len);
+
+                return out;
+            }
+
+          protected:
+
+            size_t len;
+            size_t frag_len;
+            PRODUCER producer;
+        };
+
+        /**
+         * \brief Sequence of items (list contents, call parameters)
+         */
+        template <class... ITEMS>
+        class seq
+        {
+          public:
+
+            static size_t const fixed_size = 0;
+            static bool const is_fixed = true;
+
+            size_t size() const
+            {
+                return 0;
+            }
+
+            byte *encode(byte *out) const
+            {
+                return out;
+            }
+        };
+
+        template <class FIRST, class... REST>
+        class seq<FIRST, REST...>
+        {
+          public:
+
+            static_assert(std::is_base_of<item, FIRST>::value,
+                          "Only call builder items may appear in a method call");
+
+            // Known when every item is
+            static bool const is_fixed = (FIRST::fixed_size != 0) && seq<REST...>::is_fixed;
+            static size_t const fixed_size =
+                (is_fixed ? FIRST::fixed_size + seq<REST...>::fixed_size : 0);
+
+            seq(FIRST const &first, REST const &... rest)
+                : first(first), rest(rest...)
+            {
+            }
+
+            size_t size() const
+            {
+                return (is_fixed ? fixed_size : first.size() + rest.size());
+            }
+
+            byte *encode(byte *out) const
+            {
+                return rest.encode(first.encode(out));
+            }
+
+          protected:
+
+            FIRST first;
+            seq<REST...> rest;
+        };
+
+        /**
+         * \brief List of items
+         */
+        template <class... ITEMS>
+        class list_item : public item
+        {
+          public:
+
+            static size_t const fixed_size =
+                (seq<ITEMS...>::is_fixed ? seq<ITEMS...>::fixed_size + 2 : 0);
+
+            list_item(ITEMS const &... items)
+                : items(items...)
+            {
+            }
+
+            size_t size() const
+            {
+                return items.size() + 2;
+            }
+
+            byte *encode(byte *out) const
+            {
+                *out++ = datum::TOK_START_LIST;
+                out = items.encode(out);
+                *out++ = datum::TOK_END_LIST;
+                return out;
+            }
+
+          protected:
+
+            seq<ITEMS...> items;
+        };
+
+        /**
+         * \brief Named value
+         */
+        template <class NAME, class VALUE, class BASE = item>
+        class name_item : public BASE
+        {
+          public:
+
+            static_assert(std::is_base_of<item, NAME>::value &&
+                          std::is_base_of<item, VALUE>::value,
+                          "Only call builder items may appear in a named value");
+            static size_t const fixed_size =
+                ((NAME::fixed_size && VALUE::fixed_size) ?
+                 NAME::fixed_size + VALUE::fixed_size + 2 : 0);
+
+            name_item(NAME const &name, VALUE const &value)
+                : name(name), value(value)
+            {
+            }
+
+            size_t size() const
+            {
+                return name.size() + value.size() + 2;
+            }
+
+            byte *encode(byte *out) const
+            {
+                *out++ = datum::TOK_START_NAME;
+                out = value.encode(name.encode(out));
+                *out++ = datum::TOK_END_NAME;
+                return out;
+            }
+
+          protected:
+
+            NAME name;
+            VALUE value;
+        };
+
+        /**
+         * \brief Method call
+         */
+        template <class... PARAMS>
+        class call_item
+        {
+          public:
+
+            // Call token, object / method UIDs, and parameter list
+            static size_t const fixed_size =
+                (seq<PARAMS...>::is_fixed ? seq<PARAMS...>::fixed_size + 21 : 0);
+
+            call_item(uint64_t object_uid, uint64_t method_uid, PARAMS const &... params)
+                : object(object_uid), method(method_uid), params(params...)
+            {
+            }
+
+            /**
+             * \brief Query object UID of call
+             */
+            uint64_t object_uid() const
+            {
+                return object;
+            }
+
+            /**
+             * \brief Query method UID of call
+             */
+            uint64_t method_uid() const
+            {
+                return method;
+            }
+
+            /**
+             * \brief Query encoded size
+             */
+            size_t size() const
+            {
+                return params.size() + 21;
+            }
+
+            /**
+             * \brief Encode to data buffer
+             *
+             * @param data Data buffer of at least size() bytes
+             * @return Number of bytes encoded
+             */
+            size_t encode_bytes(byte *data) const
+            {
+                byte *out = data;
+                *out++ = datum::TOK_CALL;
+                out = uid_item(object).encode(out);
+                out = uid_item(method).encode(out);
+                *out++ = datum::TOK_START_LIST;
+                out = params.encode(out);
+                *out++ = datum::TOK_END_LIST;
+                return out - data;
+            }
+
+            /**
+             * \brief Encode to data buffer
+             *
+             * @param data Buffer to hold encoded call (resized to fit)
+             */
+            void encode_vector(byte_vector &data) const
+            {
+                data.resize(size());
+                encode_bytes(&(data[0]));
+            }
+
+          protected:
+
+            uint64_t object;
+            uint64_t method;
+            seq<PARAMS...> params;
+        };
+
+        //////////////////////////////////////////////////////////////////////////
+        // Constructors
+        //
+
+        /**
+         * \brief Unsigned Integer
+         */
+        inline uint_item uint(uint64_t val)
+        {
+            return uint_item(val);
+        }
+
+        /**
+         * \brief Unique ID
+         */
+        inline uid_item uid(uint64_t val)
+        {
+            return uid_item(val);
+        }
+
+        /**
+         * \brief Binary Data
+         */
+        inline bin_item bin(byte const *data, size_t len)
+        {
+            return bin_item(data, len);
+        }
+
+        /**
+         * \brief Binary Data (C String)
+         */
+        inline bin_item bin(char const *str)
+        {
+            return bin_item((byte const*)str, strlen(str));
+        }
+
+        /**
+         * \brief Binary Data
+         */
+        inline bin_item bin(byte_vector const &data)
+        {
+            return bin_item((data.empty() ? NULL : &(data[0])), data.size());
+        }
+
+        /**
+         * \brief Binary Data (continued fragments, filled in by producer)
+         *
+         * @param len Length of whole value
+         * @param frag_len Largest fragment to encode
+         * @param producer Called as producer(out, offset, len) per fragment
+         */
+        template <class PRODUCER>
+        stream_item<PRODUCER> stream(size_t len, size_t frag_len, PRODUCER const &producer)
+        {
+            return stream_item<PRODUCER>(len, frag_len, producer);
+        }
+
+        /**
+         * \brief List
+         */
+        template <class... ITEMS>
+        list_item<ITEMS...> list(ITEMS const &... items)
+        {
+            return list_item<ITEMS...>(items...);
+        }
+
+        /**
+         * \brief Named Value
+         */
+        template <class NAME, class VALUE>
+        name_item<NAME, VALUE> name(NAME const &name, VALUE const &value)
+        {
+            return name_item<NAME, VALUE>(name, value);
+        }
+
+        /**
+         * \brief Named Value, with small integer name (optional parameters)
+         */
+        template <uint64_t NAME, class VALUE>
+        name_item<uint_const<NAME>, VALUE> named(VALUE const &value)
+        {
+            return name_item<uint_const<NAME>, VALUE>(uint_const<NAME>(), value);
+        }
+
+        /**
+         * \brief Table column, by number (Set[] values)
+         */
+        template <class VALUE>
+        name_item<uint_item, VALUE> column(uint64_t col, VALUE const &value)
+        {
+            return name_item<uint_item, VALUE>(uint_item(col), value);
+        }
+
+        /**
+         * \brief Set[] / Get[] Parameter - Where (first byte / row)
+         */
+        inline name_item<uint_const<0>, uint_item> where(uint64_t row)
+        {
+            return named<0>(uint_item(row));
+        }
+
+        /**
+         * \brief Set[] Parameter - Values
+         */
+        template <class VALUE>
+        name_item<uint_const<1>, VALUE> values(VALUE const &value)
+        {
+            return named<1>(value);
+        }
+
+        // True when every type is a Cellblock entry
+        template <class... ITEMS>
+        struct all_cells : std::true_type {};
+
+        template <class FIRST, class... REST>
+        struct all_cells<FIRST, REST...>
+            : std::integral_constant<bool, std::is_base_of<cell_item, FIRST>::value &&
+                                           all_cells<REST...>::value> {};
+
+        // Cellblock entry, eg - startColumn = 3
+        template <uint64_t NAME>
+        class cell : public name_item<uint_const<NAME>, uint_item, cell_item>
+        {
+          public:
+
+            explicit cell(uint64_t val)
+                : name_item<uint_const<NAME>, uint_item, cell_item>(uint_const<NAME>(),
+                                                                   uint_item(val))
+            {
+            }
+        };
+
+        /**
+         * \brief Cellblock - First Row
+         */
+        inline cell<1> start_row(uint64_t row)
+        {
+            return cell<1>(row);
+        }
+
+        /**
+         * \brief Cellblock - Last Row
+         */
+        inline cell<2> end_row(uint64_t row)
+        {
+            return cell<2>(row);
+        }
+
+        /**
+         * \brief Cellblock - First Column
+         */
+        inline cell<3> start_col(uint64_t col)
+        {
+            return cell<3>(col);
+        }
+
+        /**
+         * \brief Cellblock - Last Column
+         */
+        inline cell<4> end_col(uint64_t col)
+        {
+            return cell<4>(col);
+        }
+
+        /**
+         * \brief Cellblock (Get[] parameter)
+         */
+        template <class... CELLS>
+        list_item<CELLS...> cellblock(CELLS const &... cells)
+        {
+            static_assert(all_cells<CELLS...>::value,
+                          "Only start_row/end_row/start_col/end_col may appear in a Cellblock");
+            return list_item<CELLS...>(cells...);
+        }
+
+        /**
+         * \brief Method Call
+         */
+        template <class... PARAMS>
+        call_item<PARAMS...> call(uint64_t object_uid, uint64_t method_uid,
+                                  PARAMS const &... params)
+        {
+            return call_item<PARAMS...>(object_uid, method_uid, params...);
+        }
+
+    };
+
+};
+
+#endif
@@ -30,49 +30,87 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
+#include <topaz/atom_view.h>
 #include <topaz/datum.h>
 #include <topaz/exceptions.h>
+#include <topaz/uid.h>
+using namespace std;
 using namespace topaz;
 
 /**
  * \brief Default Constructor
  */
 datum::datum()
+    : data_call(NULL)
 {
     // Datum type not yet known
     data_type = datum::UNSET;
-    data_object_uid = 0;
-    data_method_uid = 0;
 }
 
 /**
  * \brief Token Constructor
  */
 datum::datum(datum::type_t data_type)
-    : data_type(data_type)
+    : data_type(data_type), data_call(NULL)
 {
-    // Specified datum type
-    data_object_uid = 0;
-    data_method_uid = 0;
-
     // Make room for named value, if needed
     if (data_type == datum::NAMED)
     {
         data_list.resize(1);
     }
+
+    // Or method UIDs
+    if (data_type == datum::METHOD)
+    {
+        call();
+    }
 }
 
 /**
  * \brief Atom->Datum Promotion Constructor
  */
-datum::datum(atom val)
+datum::datum(atom const &val)
+    : data_type(datum::ATOM), data_atom(val), data_call(NULL)
 {
-    // Datum type not yet known
-    data_type = datum::ATOM;
-    data_atom = val;
-    data_object_uid = 0;
-    data_method_uid = 0;
+    // Nada
+}
+
+/**
+ * \brief Atom->Datum Promotion Constructor (atom taken over)
+ */
+datum::datum(atom &&val)
+    : data_type(datum::ATOM), data_atom(std::move(val)), data_call(NULL)
+{
+    // Nada
+}
+
+/**
+ * \brief Copy Constructor
+ */
+datum::datum(datum const &ref)
+    : encodable(ref), data_type(ref.data_type), data_atom(ref.data_atom),
+      data_list(ref.data_list), data_call(NULL)
+{
+    // Method UIDs only exist for method calls
+    if (ref.data_call)
+    {
+        data_call = new call_t(*ref.data_call);
+    }
+}
+
+/**
+ * \brief Move Constructor
+ */
+datum::datum(datum &&ref)
+    : encodable(ref), data_type(ref.data_type), data_atom(std::move(ref.data_atom)),
+      data_list(std::move(ref.data_list)), data_call(ref.data_call)
+{
+    // Leave other datum unset
+    ref.data_type = datum::UNSET;
+    ref.data_call = NULL;
 }
 
 /**
@@ -80,7 +118,55 @@ datum::datum(atom val)
  */
 datum::~datum()
 {
-    // Nada
+    delete data_call;
+}
+
+/**
+ * \brief Assignment Operator
+ */
+datum &datum::operator=(datum const &ref)
+{
+    data_type = ref.data_type;
+    data_atom = ref.data_atom;
+    data_list = ref.data_list;
+
+    // Method UIDs only exist for method calls (storage kept for reuse)
+    if (ref.data_call)
+    {
+        call() = *ref.data_call;
+    }
+
+    return *this;
+}
+
+/**
+ * \brief Move Assignment Operator
+ */
+datum &datum::operator=(datum &&ref)
+{
+    if (this != &ref)
+    {
+        // Whole tree changes hands, no items are copied
+        uint8_t type = ref.data_type;
+        atom val(std::move(ref.data_atom));
+        datum_vector items;
+        items.swap(ref.data_list);
+        call_t *uids = ref.data_call;
+
+        // Leave other datum unset
+        ref.data_type = datum::UNSET;
+        ref.data_call = NULL;
+
+        // NOTE: Other datum may well be one of our own items (eg - d =
+        // std::move(d[0])), so old items are only released on the way out
+        data_type = type;
+        data_atom = std::move(val);
+        data_list.swap(items);
+        std::swap(data_call, uids);
+        delete uids;
+    }
+
+    return *this;
 }
 
 /**
@@ -169,10 +255,12 @@ size_t datum::encode_bytes(byte *data) const
             *data++ = datum::TOK_CALL;
 
             // Object UID
-            data += atom::new_uid(data_object_uid).encode_bytes(data);
+            memcpy(data, uid_token(data_call->object_uid).bytes, sizeof(uid_token_t));
+            data += sizeof(uid_token_t);
 
             // Method UID
-            data += atom::new_uid(data_method_uid).encode_bytes(data);
+            memcpy(data, uid_token(data_call->method_uid).bytes, sizeof(uid_token_t));
+            data += sizeof(uid_token_t);
 
             // No break - fall through to handle parameters
 
@@ -199,6 +287,39 @@ size_t datum::encode_bytes(byte *data) const
     return data - orig;
 }
 
+// Decode budgets (see set_decode_limits)
+atomic<size_t> datum::decode_max_depth(DATUM_MAX_DEPTH);
+atomic<size_t> datum::decode_max_nodes(DATUM_MAX_NODES);
+
+/**
+ * \brief Set limits on decoding, applied to every decode_bytes() call
+ *
+ * @param max_depth Maximum nesting of lists / names / method calls
+ * @param max_nodes Maximum number of items decoded in one call
+ */
+void datum::set_decode_limits(size_t max_depth, size_t max_nodes)
+{
+    // Each limit stands on its own, so no need to swap both at once
+    decode_max_depth.store(max_depth, memory_order_relaxed);
+    decode_max_nodes.store(max_nodes, memory_order_relaxed);
+}
+
+/**
+ * \brief Query maximum decode nesting depth
+ */
+size_t datum::get_decode_max_depth()
+{
+    return decode_max_depth.load(memory_order_relaxed);
+}
+
+/**
+ * \brief Query maximum decoded items per call
+ */
+size_t datum::get_decode_max_nodes()
+{
+    return decode_max_nodes.load(memory_order_relaxed);
+}
+
 /**
  * \brief Decode from data buffer
  *
@@ -208,110 +329,157 @@ size_t datum::encode_bytes(byte *data) const
  */
 size_t datum::decode_bytes(byte const *data, size_t len)
 {
-    size_t size = 0;
-
-    // Clear out any stale data
-    data_list.clear();
-
-    // Minimum 1 byte
-    decode_check_size(len, 1);
-
-    // What is it?
-    if (data[size] == datum::TOK_START_LIST)
-    {
-        // Start of a list type
-        data_type = datum::LIST;
-        size++;
-
-        // Loop until we hit the end of the list
-        while (1)
+    typedef struct
+    {
+        datum  *node;  // Open list / named value / method call
+        size_t  count; // List items decoded so far
+    } frame_t;
+
+    frame_t inline_stack[DATUM_STACK_INLINE];
+    vector<frame_t> spill_stack;
+    frame_t *stack = inline_stack;
+    size_t depth = 0, stack_size = DATUM_STACK_INLINE;
+    size_t size = 0, nodes = 0;
+    size_t max_depth = get_decode_max_depth(), max_nodes = get_decode_max_nodes();
+    datum *node = this;
+
+    // NOTE: Any existing list items are decoded over in place, so
+    // decoding similar data into the same datum again (eg - responses
+    // to repeated method calls) reuses their storage, rather than
+    // tearing down and reallocating the whole tree.
+    //
+    // Nesting is tracked on an explicit stack rather than by recursion,
+    // and both nesting and item count are capped, so hostile input can
+    // neither exhaust the call stack nor blow up into a huge tree.
+
+    while (1)
+    {
+        // Decode one item into node
+        decode_check_size(len, size + 1);
+        if (++nodes > max_nodes)
         {
-            // Ensure one more byte
-            decode_check_size(len, size + 1);
+            throw topaz_exception("Datum encoding has too many items");
+        }
 
-            // End of list?
-            if (data[size] == datum::TOK_END_LIST)
+        // Containers get pushed onto the stack
+        if ((data[size] == datum::TOK_START_LIST) ||
+            (data[size] == datum::TOK_START_NAME) ||
+            (data[size] == datum::TOK_CALL))
+        {
+            if (depth == max_depth)
             {
-                // Done here
-                size++;
-                break;
+                throw topaz_exception("Datum encoding nested too deeply");
             }
-
-            // Else, assume some other datum type
-            datum tmp;
-            size += tmp.decode_bytes(data + size, len - size);
-            data_list.push_back(tmp);
+            if (depth == stack_size)
+            {
+                // Only very deep data ever gets here
+                spill_stack.resize(stack_size * 2);
+                if (stack == inline_stack)
+                {
+                    copy(inline_stack, inline_stack + depth, spill_stack.begin());
+                }
+                stack = &(spill_stack[0]);
+                stack_size *= 2;
+            }
+            stack[depth].node = node;
+            stack[depth].count = 0;
+            depth++;
         }
-    }
-    else if (data[size] == datum::TOK_START_NAME)
-    {
-        // Named data type
-        data_type = datum::NAMED;
-        size++;
-
-        // Name
-        size += data_atom.decode_bytes(data + size, len - size);
 
-        // Value
-        data_list.resize(1);
-        size += data_list[0].decode_bytes(data + size, len - size);
-
-        // End of named type
-        decode_check_token(data, len, size++, datum::TOK_END_NAME);
-    }
-    else if (data[size] == datum::TOK_CALL)
-    {
-        atom uid;
-
-        // Method call
-        data_type = datum::METHOD;
-        size++;
-
-        // Object UID
-        size += uid.decode_bytes(data + size, len - size);
-        data_object_uid = uid.get_uid();
+        // What is it?
+        if (data[size] == datum::TOK_START_LIST)
+        {
+            // Start of a list type (items follow)
+            node->data_type = datum::LIST;
+            size++;
+        }
+        else if (data[size] == datum::TOK_START_NAME)
+        {
+            // Named data type
+            node->data_type = datum::NAMED;
+            size++;
 
-        // Method UID
-        size += uid.decode_bytes(data + size, len - size);
-        data_method_uid = uid.get_uid();
+            // Name
+            size += node->data_atom.decode_bytes(data + size, len - size);
 
-        // Beginning of parameter list (arguments
-        decode_check_token(data, len, size++, datum::TOK_START_LIST);
+            // Value goes next
+            node->data_list.resize(1);
+            node = &(node->data_list[0]);
+            continue;
+        }
+        else if (data[size] == datum::TOK_CALL)
+        {
+            // Method call
+            node->call();
+            node->data_type = datum::METHOD;
+            size++;
+
+            // Object UID (read in place)
+            atom_view object(data + size, len - size);
+            node->call().object_uid = object.get_uid();
+            size += object.size();
+
+            // Method UID (read in place)
+            atom_view method(data + size, len - size);
+            node->call().method_uid = method.get_uid();
+            size += method.size();
+
+            // Beginning of parameter list (items follow)
+            decode_check_token(data, len, size++, datum::TOK_START_LIST);
+        }
+        else if (data[size] == datum::TOK_END_SESSION)
+        {
+            // End of Session indicator
+            node->data_type = datum::END_SESSION;
+            node->data_list.clear();
+            size++;
+        }
+        else
+        {
+            // Failing that, assume it's an atom
+            node->data_type = datum::ATOM;
+            node->data_list.clear();
+            size += node->data_atom.decode_bytes(data + size, len - size);
+        }
 
-        // Loop until we hit the end of the list
+        // Close out finished containers, until something needs an item
         while (1)
         {
-            // Ensure one more byte
-            decode_check_size(len, size + 1);
+            // Top level item done?
+            if (depth == 0)
+            {
+                return size;
+            }
+            frame_t &top = stack[depth - 1];
+
+            // Named value done
+            if (top.node->data_type == datum::NAMED)
+            {
+                decode_check_token(data, len, size++, datum::TOK_END_NAME);
+                depth--;
+                continue;
+            }
 
             // End of list?
+            decode_check_size(len, size + 1);
             if (data[size] == datum::TOK_END_LIST)
             {
-                // Done here
+                // Drop any items left over from previous contents
+                top.node->data_list.resize(top.count);
                 size++;
-                break;
+                depth--;
+                continue;
             }
 
-            // Else, assume some other datum type
-            datum tmp;
-            size += tmp.decode_bytes(data + size, len - size);
-            data_list.push_back(tmp);
+            // Else, next list item (decoded in place)
+            if (top.count == top.node->data_list.size())
+            {
+                top.node->data_list.resize(top.count + 1);
+            }
+            node = &(top.node->data_list[top.count++]);
+            break;
         }
     }
-    else if (data[size] == datum::TOK_END_SESSION)
-    {
-        // End of Session indicator
-        data_type = datum::END_SESSION;
-        size++;
-    }
-    else
-    {
-        // Failing that, assume it's an atom
-        data_type = datum::ATOM;
-        size += data_atom.decode_bytes(data + size, len - size);
-    }
-
-    return size;
 }
 
 /**
@@ -319,7 +487,7 @@ size_t datum::decode_bytes(byte const *data, size_t len)
  */
 datum::type_t datum::get_type() const
 {
-    return data_type;
+    return (datum::type_t)data_type;
 }
 
 /**
@@ -438,6 +606,7 @@ uint64_t &datum::object_uid()
     if ((data_type == datum::UNSET) || (data_type == datum::LIST))
     {
         // Automatic promotion
+        call();
         data_type = datum::METHOD;
     }
     else if (data_type != datum::METHOD)
@@ -445,7 +614,7 @@ uint64_t &datum::object_uid()
         throw topaz_exception("Datum has no object UID");
     }
 
-    return data_object_uid;
+    return call().object_uid;
 }
 
 /**
@@ -459,7 +628,7 @@ uint64_t const &datum::object_uid() const
         throw topaz_exception("Datum has no object UID");
     }
 
-    return data_object_uid;
+    return data_call->object_uid;
 }
 
 /**
@@ -471,6 +640,7 @@ uint64_t &datum::method_uid()
     if ((data_type == datum::UNSET) || (data_type == datum::LIST))
     {
         // Automatic promotion
+        call();
         data_type = datum::METHOD;
     }
     else if (data_type != datum::METHOD)
@@ -478,7 +648,7 @@ uint64_t &datum::method_uid()
         throw topaz_exception("Datum has no method UID");
     }
 
-    return data_method_uid;
+    return call().method_uid;
 }
 
 /**
@@ -492,7 +662,7 @@ uint64_t const &datum::method_uid() const
         throw topaz_exception("Datum has no method UID");
     }
 
-    return data_method_uid;
+    return data_call->method_uid;
 }
 
 /**
@@ -604,8 +774,8 @@ bool datum::operator==(datum const &ref)
 
             case datum::METHOD:
                 // Compare method calls
-                if ((data_object_uid != ref.data_object_uid) ||
-                    (data_method_uid != ref.data_method_uid))
+                if ((data_call->object_uid != ref.data_call->object_uid) ||
+                    (data_call->method_uid != ref.data_call->method_uid))
                 {
                     // Failure
                     return false;
@@ -678,6 +848,30 @@ datum &datum::operator[](size_t idx)
     return data_list[idx];
 }
 
+/**
+ * \brief Datum array access (const)
+ *
+ * @param idx Item to return
+ * @return Specified item
+ */
+datum const &datum::operator[](size_t idx) const
+{
+    // Must be list or method call
+    if ((data_type != datum::LIST) && (data_type != datum::METHOD))
+    {
+        throw topaz_exception("Datum has no list");
+    }
+
+    // No resizing here
+    if (data_list.size() <= idx)
+    {
+        throw topaz_exception("Datum list index out of range");
+    }
+
+    // Return item
+    return data_list[idx];
+}
+
 /**
  * \brief Debug print
  */
@@ -707,9 +901,9 @@ void datum::print() const
 
         case datum::METHOD:
             // Method Call
-            atom::new_uid(data_object_uid).print();
+            atom::new_uid(data_call->object_uid).print();
             printf(".");
-            atom::new_uid(data_method_uid).print();
+            atom::new_uid(data_call->method_uid).print();
 
             // No break - fall through to handle parameters
 
@@ -765,3 +959,18 @@ void datum::decode_check_token(byte const *data, size_t len, size_t idx, byte ne
         throw topaz_exception("Unexpected token in datum encoding");
     }
 }
+
+/**
+ * \brief Method UID storage, allocated on first use
+ */
+datum::call_t &datum::call()
+{
+    if (data_call == NULL)
+    {
+        data_call = new call_t();
+        data_call->object_uid = 0;
+        data_call->method_uid = 0;
+    }
+
+    return *data_call;
+}
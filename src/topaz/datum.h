@@ -33,15 +33,26 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <atomic>
 #include <topaz/atom.h>
 #include <topaz/encodable.h>
 
+// Default limits on decoding (see datum::set_decode_limits)
+#define DATUM_MAX_DEPTH 32
+#define DATUM_MAX_NODES 65536
+
+// Decode nesting tracked without heap allocation up to this depth
+#define DATUM_STACK_INLINE 16
+
 namespace topaz
 {
 
     class datum : public encodable
     {
 
+        // Decodes straight into internals
+        friend class datum_builder;
+
       public:
 
         // Enumeration of various datum types
@@ -108,13 +119,38 @@ namespace topaz
         /**
          * \brief Atom->Datum Promotion Constructor
          */
-        datum(atom val);
+        datum(atom const &val);
+
+        /**
+         * \brief Atom->Datum Promotion Constructor (atom taken over)
+         */
+        datum(atom &&val);
+
+        /**
+         * \brief Copy Constructor
+         */
+        datum(datum const &ref);
+
+        /**
+         * \brief Move Constructor
+         */
+        datum(datum &&ref);
 
         /**
          * \brief Destructor
          */
         ~datum();
 
+        /**
+         * \brief Assignment Operator
+         */
+        datum &operator=(datum const &ref);
+
+        /**
+         * \brief Move Assignment Operator
+         */
+        datum &operator=(datum &&ref);
+
         /**
          * \brief Query encoded size
          *
@@ -139,6 +175,29 @@ namespace topaz
          */
         virtual size_t decode_bytes(byte const *data, size_t len);
 
+        /**
+         * \brief Set limits on decoding, applied to every decode_bytes() call
+         *
+         * Guards against hostile or corrupt data, whether nested deep
+         * enough to exhaust the stack, or with enough items to build an
+         * enormous tree. Limits are process wide, and may be changed from
+         * any thread; each decode_bytes() call reads them once on entry.
+         *
+         * @param max_depth Maximum nesting of lists / names / method calls
+         * @param max_nodes Maximum number of items decoded in one call
+         */
+        static void set_decode_limits(size_t max_depth, size_t max_nodes);
+
+        /**
+         * \brief Query maximum decode nesting depth
+         */
+        static size_t get_decode_max_depth();
+
+        /**
+         * \brief Query maximum decoded items per call
+         */
+        static size_t get_decode_max_nodes();
+
         /**
          * \brief Query Datum Type
          */
@@ -236,6 +295,14 @@ namespace topaz
          */
         datum &operator[](size_t idx);
 
+        /**
+         * \brief Datum array access (const)
+         *
+         * @param idx Item to return
+         * @return Specified item
+         */
+        datum const &operator[](size_t idx) const;
+
         /**
          * \brief Debug print
          */
@@ -261,16 +328,29 @@ namespace topaz
          */
         void decode_check_token(byte const *data, size_t len, size_t idx, byte next) const;
 
-        // What sort of object
-        datum::type_t data_type;
+        // Method call specific parameters
+        typedef struct
+        {
+            uint64_t object_uid;  // Object reference
+            uint64_t method_uid;  // Method reference
+        } call_t;
+
+        /**
+         * \brief Method UID storage, allocated on first use
+         */
+        call_t &call();
+
+        // Decode budgets (shared by every thread, hence atomic)
+        static std::atomic<size_t> decode_max_depth;
+        static std::atomic<size_t> decode_max_nodes;
+
+        // What sort of object (datum::type_t)
+        uint8_t data_type;
 
         // Data storage
         atom         data_atom;   // Valid as single atom, or name of value
         datum_vector data_list;   // List of values
-
-        // Method call specific parameters
-        uint64_t data_object_uid; // Object reference
-        uint64_t data_method_uid; // Method reference
+        call_t      *data_call;   // Method calls only (NULL otherwise)
 
     };
 
@@ -0,0 +1,304 @@
+/**
+ * Topaz - Datum Builder
+ *
+ * This class sits on top of the token parser, and assembles the tokens it
+ * finds back into a datum tree. Nesting is tracked on an explicit stack
+ * rather than by recursion, and existing contents of the target datum are
+ * decoded over in place, reusing their storage.
+ *
+ * Copyright (c) 2014, T Parys
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <topaz/datum_builder.h>
+#include <topaz/exceptions.h>
+using namespace std;
+using namespace topaz;
+
+/**
+ * \brief Constructor
+ *
+ * @param target Datum to decode into
+ */
+datum_builder::datum_builder(datum &target)
+    : target(&target), started(false), nodes(0)
+{
+    // Nada
+}
+
+/**
+ * \brief Start over with new target (keeps stack storage)
+ *
+ * @param target Datum to decode into
+ */
+void datum_builder::reset(datum &target)
+{
+    this->target = &target;
+    started = false;
+    nodes = 0;
+    stack.clear();
+}
+
+/**
+ * \brief Start of List Token
+ */
+void datum_builder::start_list()
+{
+    // Parameter list of method call?
+    if ((!stack.empty()) && (stack.back().state == CALL_LIST))
+    {
+        stack.back().state = IN_LIST;
+        return;
+    }
+
+    // Else, new list
+    datum *node = slot();
+    node->data_type = datum::LIST;
+    push(node, IN_LIST);
+}
+
+/**
+ * \brief End of List Token
+ */
+void datum_builder::end_list()
+{
+    if ((stack.empty()) || (stack.back().state != IN_LIST))
+    {
+        unexpected();
+    }
+
+    // Drop any items left over from previous contents
+    frame_t &top = stack.back();
+    top.node->data_list.resize(top.count);
+    stack.pop_back();
+    complete();
+}
+
+/**
+ * \brief Start of Name Token
+ */
+void datum_builder::start_name()
+{
+    datum *node = slot();
+    node->data_type = datum::NAMED;
+    node->data_list.resize(1);
+    push(node, NAME_NAME);
+}
+
+/**
+ * \brief End of Name Token
+ */
+void datum_builder::end_name()
+{
+    if ((stack.empty()) || (stack.back().state != NAME_END))
+    {
+        unexpected();
+    }
+
+    stack.pop_back();
+    complete();
+}
+
+/**
+ * \brief Method Call Token
+ */
+void datum_builder::call()
+{
+    datum *node = slot();
+    node->call();
+    node->data_type = datum::METHOD;
+    push(node, CALL_OBJECT);
+}
+
+/**
+ * \brief End of Data Token
+ */
+void datum_builder::end_of_data()
+{
+    unexpected();
+}
+
+/**
+ * \brief End of Session Token
+ */
+void datum_builder::end_session()
+{
+    datum *node = slot();
+    node->data_type = datum::END_SESSION;
+    node->data_list.clear();
+    complete();
+}
+
+/**
+ * \brief Start of Transaction Token
+ *
+ * @param code Transaction code
+ */
+void datum_builder::start_transaction(unsigned code)
+{
+    unexpected();
+}
+
+/**
+ * \brief End of Transaction Token
+ *
+ * @param code Transaction code
+ */
+void datum_builder::end_transaction(unsigned code)
+{
+    unexpected();
+}
+
+/**
+ * \brief Atom (in place)
+ *
+ * @param val View of encoded atom
+ */
+void datum_builder::atom_token(atom_view const &val)
+{
+    byte_span_t raw = val.get_encoded();
+
+    // Atoms that are part of an open node, rather than a value
+    if (!stack.empty())
+    {
+        frame_t &top = stack.back();
+        switch (top.state)
+        {
+            case NAME_NAME:
+                top.node->data_atom.decode_bytes(raw.ptr, raw.len);
+                top.state = NAME_VALUE;
+                return;
+
+            case CALL_OBJECT:
+                top.node->call().object_uid = val.get_uid();
+                top.state = CALL_METHOD;
+                return;
+
+            case CALL_METHOD:
+                top.node->call().method_uid = val.get_uid();
+                top.state = CALL_LIST;
+                return;
+
+            default:
+                break;
+        }
+    }
+
+    // Else, plain atom value
+    datum *node = slot();
+    node->data_type = datum::ATOM;
+    node->data_list.clear();
+    node->data_atom.decode_bytes(raw.ptr, raw.len);
+    complete();
+}
+
+/**
+ * \brief Query if target datum is complete
+ *
+ * @return True once a whole datum has been decoded
+ */
+bool datum_builder::done() const
+{
+    return started && stack.empty();
+}
+
+/**
+ * \brief Find datum to decode next value into
+ *
+ * @return Next slot in open node (or target)
+ */
+datum *datum_builder::slot()
+{
+    // Same item limit as datum decoding
+    if (++nodes > datum::get_decode_max_nodes())
+    {
+        throw topaz_exception("Datum encoding has too many items");
+    }
+
+    // Top level
+    if (stack.empty())
+    {
+        if (started)
+        {
+            unexpected();
+        }
+        started = true;
+        return target;
+    }
+
+    frame_t &top = stack.back();
+    switch (top.state)
+    {
+        case IN_LIST:
+            // Decoded in place, over any existing item
+            if (top.count == top.node->data_list.size())
+            {
+                top.node->data_list.resize(top.count + 1);
+            }
+            return &(top.node->data_list[top.count++]);
+
+        case NAME_VALUE:
+            return &(top.node->data_list[0]);
+
+        default:
+            unexpected();
+            return NULL;
+    }
+}
+
+/**
+ * \brief Open new node
+ *
+ * @param node Node being decoded
+ * @param state What comes next
+ */
+void datum_builder::push(datum *node, state_t state)
+{
+    // Same nesting limit as datum decoding
+    if (stack.size() >= datum::get_decode_max_depth())
+    {
+        throw topaz_exception("Datum encoding nested too deeply");
+    }
+
+    frame_t frame = {node, 0, state};
+    stack.push_back(frame);
+}
+
+/**
+ * \brief Note completion of a value in open node
+ */
+void datum_builder::complete()
+{
+    if ((!stack.empty()) && (stack.back().state == NAME_VALUE))
+    {
+        stack.back().state = NAME_END;
+    }
+}
+
+/**
+ * \brief Reject token not valid within a datum
+ */
+void datum_builder::unexpected() const
+{
+    throw topaz_exception("Unexpected token in datum encoding");
+}
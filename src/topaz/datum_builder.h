@@ -0,0 +1,182 @@
+#ifndef TOPAZ_DATUM_BUILDER_H
+#define TOPAZ_DATUM_BUILDER_H
+
+/**
+ * Topaz - Datum Builder
+ *
+ * This class sits on top of the token parser, and assembles the tokens it
+ * finds back into a datum tree. Nesting is tracked on an explicit stack
+ * rather than by recursion, and existing contents of the target datum are
+ * decoded over in place, reusing their storage.
+ *
+ * Copyright (c) 2014, T Parys
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <vector>
+#include <topaz/datum.h>
+#include <topaz/token_parser.h>
+
+namespace topaz
+{
+
+    class datum_builder : public token_handler
+    {
+
+      public:
+
+        /**
+         * \brief Constructor
+         *
+         * @param target Datum to decode into
+         */
+        datum_builder(datum &target);
+
+        /**
+         * \brief Start over with new target (keeps stack storage)
+         *
+         * @param target Datum to decode into
+         */
+        void reset(datum &target);
+
+        /**
+         * \brief Start of List Token
+         */
+        virtual void start_list();
+
+        /**
+         * \brief End of List Token
+         */
+        virtual void end_list();
+
+        /**
+         * \brief Start of Name Token
+         */
+        virtual void start_name();
+
+        /**
+         * \brief End of Name Token
+         */
+        virtual void end_name();
+
+        /**
+         * \brief Method Call Token
+         */
+        virtual void call();
+
+        /**
+         * \brief End of Data Token
+         */
+        virtual void end_of_data();
+
+        /**
+         * \brief End of Session Token
+         */
+        virtual void end_session();
+
+        /**
+         * \brief Start of Transaction Token
+         *
+         * @param code Transaction code
+         */
+        virtual void start_transaction(unsigned code);
+
+        /**
+         * \brief End of Transaction Token
+         *
+         * @param code Transaction code
+         */
+        virtual void end_transaction(unsigned code);
+
+        /**
+         * \brief Atom (in place)
+         *
+         * @param val View of encoded atom
+         */
+        virtual void atom_token(atom_view const &val);
+
+        /**
+         * \brief Query if target datum is complete
+         *
+         * @return True once a whole datum has been decoded
+         */
+        virtual bool done() const;
+
+      protected:
+
+        // Where each open node is at
+        typedef enum
+        {
+            IN_LIST,       // List items
+            NAME_NAME,     // Named value, expecting name
+            NAME_VALUE,    // Named value, expecting value
+            NAME_END,      // Named value, expecting end of name
+            CALL_OBJECT,   // Method call, expecting object UID
+            CALL_METHOD,   // Method call, expecting method UID
+            CALL_LIST      // Method call, expecting parameter list
+        } state_t;
+
+        // One open (partially decoded) node
+        typedef struct
+        {
+            datum   *node;  // Node being decoded
+            size_t   count; // List items decoded so far
+            state_t  state; // What comes next
+        } frame_t;
+
+        /**
+         * \brief Find datum to decode next value into
+         *
+         * @return Next slot in open node (or target)
+         */
+        datum *slot();
+
+        /**
+         * \brief Open new node
+         *
+         * @param node Node being decoded
+         * @param state What comes next
+         */
+        void push(datum *node, state_t state);
+
+        /**
+         * \brief Note completion of a value in open node
+         */
+        void complete();
+
+        /**
+         * \brief Reject token not valid within a datum
+         */
+        void unexpected() const;
+
+        // Decode state
+        datum *target;              // Top level datum
+        bool started;               // Target slot already used?
+        size_t nodes;               // Items decoded so far
+        std::vector<frame_t> stack; // Open nodes, innermost last
+
+    };
+
+};
+
+#endif
@@ -0,0 +1,513 @@
+/**
+ * Topaz - Datum View
+ *
+ * This class is a read-only view of an encoded TCG Opal data stream item
+ * (atom, named value, list, or method call), sitting in a buffer owned by
+ * someone else. Nothing is decoded until asked for, and walking to a list
+ * item or named value simply skips over the encoded bytes before it, so
+ * picking a few fields out of a large response costs no allocations. The
+ * view is only valid as long as the underlying buffer.
+ *
+ * Copyright (c) 2014, T Parys
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <topaz/datum_view.h>
+#include <topaz/exceptions.h>
+using namespace topaz;
+
+/**
+ * \brief Default Constructor (Unset)
+ */
+datum_view::datum_view()
+    : data(NULL), len(0), data_type(datum::UNSET)
+{
+    // Nada
+}
+
+/**
+ * \brief Buffer Constructor
+ *
+ * @param data Location of encoded datum
+ * @param len  Length of buffer
+ */
+datum_view::datum_view(byte const *data, size_t len)
+    : data(data), len(len), data_type(datum::UNSET)
+{
+    // Minimum 1 byte (rest is checked as it gets walked)
+    if (len < 1)
+    {
+        throw topaz_exception("Datum encoding too short");
+    }
+    data_type = classify(data[0]);
+}
+
+/**
+ * \brief Buffer Constructor
+ *
+ * @param data Buffer holding encoded datum
+ */
+datum_view::datum_view(byte_vector const &data)
+    : datum_view(data.empty() ? NULL : &(data[0]), data.size())
+{
+    // Nada
+}
+
+/**
+ * \brief Measure encoded datum without decoding it
+ *
+ * @param data Location of encoded datum
+ * @param len  Length of buffer
+ * @return Byte count of datum in buffer
+ */
+size_t datum_view::skip(byte const *data, size_t len)
+{
+    return skip(data, len, 0);
+}
+
+/**
+ * \brief Measure encoded datum, at given nesting depth
+ *
+ * @param data Location of encoded datum
+ * @param len  Length of buffer
+ * @param depth Nesting depth of datum
+ * @return Byte count of datum in buffer
+ */
+size_t datum_view::skip(byte const *data, size_t len, size_t depth)
+{
+    size_t size = 0;
+
+    // Minimum 1 byte
+    if (len < 1)
+    {
+        throw topaz_exception("Datum encoding too short");
+    }
+
+    // What is it?
+    if (data[size] < atom::SHORT_TOK)
+    {
+        // Tiny atom (by far the most common, so handled up front)
+        return 1;
+    }
+    else if (((data[size] == datum::TOK_START_NAME) ||
+              (data[size] == datum::TOK_START_LIST) ||
+              (data[size] == datum::TOK_CALL)) &&
+             (depth >= datum::get_decode_max_depth()))
+    {
+        // Same nesting limit as datum decoding
+        throw topaz_exception("Datum encoding nested too deeply");
+    }
+    else if (data[size] == datum::TOK_START_NAME)
+    {
+        // Name, value, end of name
+        size++;
+        size += atom_view(data + size, len - size).size();
+        size += skip(data + size, len - size, depth + 1);
+        if ((size >= len) || (data[size] != datum::TOK_END_NAME))
+        {
+            throw topaz_exception("Unexpected token in datum encoding");
+        }
+        return size + 1;
+    }
+    else if (data[size] == datum::TOK_CALL)
+    {
+        // Object / Method UIDs, then parameter list
+        size++;
+        for (int i = 0; i < 2; i++)
+        {
+            atom_view uid(data + size, len - size);
+            uid.get_uid();
+            size += uid.size();
+        }
+        if ((size >= len) || (data[size] != datum::TOK_START_LIST))
+        {
+            throw topaz_exception("Unexpected token in datum encoding");
+        }
+    }
+    else if (data[size] == datum::TOK_END_SESSION)
+    {
+        // End of Session indicator
+        return 1;
+    }
+    else if (data[size] != datum::TOK_START_LIST)
+    {
+        // Failing that, assume it's an atom
+        return atom_view(data, len).size();
+    }
+
+    // Walk list items until end of list
+    size++;
+    while (1)
+    {
+        // Ensure one more byte
+        if (size >= len)
+        {
+            throw topaz_exception("Datum encoding too short");
+        }
+
+        // End of list?
+        if (data[size] == datum::TOK_END_LIST)
+        {
+            return size + 1;
+        }
+
+        // Else, step over some other datum type
+        size += skip(data + size, len - size, depth + 1);
+    }
+}
+
+/**
+ * \brief Query encoded size (walks whole datum)
+ *
+ * @return Byte count of datum in buffer
+ */
+size_t datum_view::size() const
+{
+    return (data ? skip(data, len) : 0);
+}
+
+/**
+ * \brief Query Datum Type
+ */
+datum::type_t datum_view::get_type() const
+{
+    return data_type;
+}
+
+/**
+ * \brief Query Atom Value
+ */
+atom_view datum_view::value() const
+{
+    // Must be atom type
+    if (data_type != datum::ATOM)
+    {
+        throw topaz_exception("Datum has no value");
+    }
+
+    return atom_view(data, len);
+}
+
+/**
+ * \brief Query Name
+ */
+atom_view datum_view::name() const
+{
+    // Must be named type
+    if (data_type != datum::NAMED)
+    {
+        throw topaz_exception("Datum has no name");
+    }
+
+    return atom_view(data + 1, len - 1);
+}
+
+/**
+ * \brief Query Named Value
+ */
+datum_view datum_view::named_value() const
+{
+    // Must be named type
+    if (data_type != datum::NAMED)
+    {
+        throw topaz_exception("Datum has no named value");
+    }
+
+    // Value sits between name and end of name token
+    size_t size = 1 + atom_view(data + 1, len - 1).size();
+    return datum_view(data + size, len - size);
+}
+
+/**
+ * \brief Query Method's Object UID
+ */
+uint64_t datum_view::object_uid() const
+{
+    // Must be method type
+    if (data_type != datum::METHOD)
+    {
+        throw topaz_exception("Datum has no object UID");
+    }
+
+    return atom_view(data + 1, len - 1).get_uid();
+}
+
+/**
+ * \brief Query Method's Method UID
+ */
+uint64_t datum_view::method_uid() const
+{
+    // Must be method type
+    if (data_type != datum::METHOD)
+    {
+        throw topaz_exception("Datum has no method UID");
+    }
+
+    // Method follows object
+    size_t size = 1 + atom_view(data + 1, len - 1).size();
+    return atom_view(data + size, len - size).get_uid();
+}
+
+/**
+ * \brief Query Number of Items in List
+ */
+size_t datum_view::count() const
+{
+    size_t size = list_start(), items = 0;
+
+    while (!at_end(size))
+    {
+        size += skip(data + size, len - size);
+        items++;
+    }
+
+    return items;
+}
+
+/**
+ * \brief Query Named Value in List
+ */
+datum_view datum_view::find_by_name(uint64_t id) const
+{
+    // Must be list
+    if (data_type != datum::LIST)
+    {
+        throw topaz_exception("Datum has no list");
+    }
+
+    // Search for named value
+    size_t size = 1;
+    while (!at_end(size))
+    {
+        if (data[size] == datum::TOK_START_NAME)
+        {
+            datum_view item(data + size, len - size);
+            atom_view item_name = item.name();
+            if ((item_name.get_type() == atom::UINT) && (item_name.get_uint() == id))
+            {
+                return item.named_value();
+            }
+        }
+        size += skip(data + size, len - size);
+    }
+
+    throw topaz_exception("Named value not found in list");
+}
+
+/**
+ * \brief Datum array access
+ *
+ * @param idx Item to return
+ * @return Specified item
+ */
+datum_view datum_view::operator[](size_t idx) const
+{
+    size_t size = list_start();
+
+    // Step over everything before it
+    for (size_t i = 0; i < idx; i++)
+    {
+        if (at_end(size))
+        {
+            throw topaz_exception("Datum list index out of range");
+        }
+        size += skip(data + size, len - size);
+    }
+    if (at_end(size))
+    {
+        throw topaz_exception("Datum list index out of range");
+    }
+
+    return datum_view(data + size, len - size);
+}
+
+/**
+ * \brief Step through list items, in a single pass
+ *
+ * @param pos Offset of item, starting from zero (updated to next item)
+ * @param item Item found there
+ * @return False once end of list reached
+ */
+bool datum_view::next_item(size_t &pos, datum_view &item) const
+{
+    // First item?
+    if (pos == 0)
+    {
+        pos = list_start();
+    }
+    if (at_end(pos))
+    {
+        return false;
+    }
+
+    item = datum_view(data + pos, len - pos);
+    pos += skip(data + pos, len - pos);
+    return true;
+}
+
+/**
+ * \brief Step through named values in list, in a single pass
+ *
+ * Other list items are stepped over.
+ *
+ * @param pos Offset of item, starting from zero (updated to next item)
+ * @param name Name of named value found
+ * @param value Value of named value found
+ * @return False once end of list reached
+ */
+bool datum_view::next_named(size_t &pos, atom_view &name, datum_view &value) const
+{
+    // First item?
+    if (pos == 0)
+    {
+        pos = list_start();
+    }
+
+    while (!at_end(pos))
+    {
+        // Not interested in anything else
+        if (data[pos] != datum::TOK_START_NAME)
+        {
+            pos += skip(data + pos, len - pos);
+            continue;
+        }
+
+        // Name, value, end of name (each looked at once)
+        size_t size = pos + 1;
+        name = atom_view(data + size, len - size);
+        size += name.size();
+        value = datum_view(data + size, len - size);
+        size += skip(data + size, len - size, 1);
+        if ((size >= len) || (data[size] != datum::TOK_END_NAME))
+        {
+            throw topaz_exception("Unexpected token in datum encoding");
+        }
+        pos = size + 1;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * \brief Get Unsigned Integer Value (Atom)
+ */
+uint64_t datum_view::get_uint() const
+{
+    return value().get_uint();
+}
+
+/**
+ * \brief Get Unique ID Value (Atom)
+ */
+uint64_t datum_view::get_uid() const
+{
+    return value().get_uid();
+}
+
+/**
+ * \brief Get Copy as Owning Datum
+ */
+datum datum_view::get_datum() const
+{
+    datum ret;
+
+    // Unset view has no buffer to decode
+    if (data)
+    {
+        ret.decode_bytes(data, len);
+    }
+
+    return ret;
+}
+
+/**
+ * \brief Determine datum type from leading token
+ *
+ * @param tok First byte of encoded datum
+ * @return Type of datum
+ */
+datum::type_t datum_view::classify(byte tok)
+{
+    switch (tok)
+    {
+        case datum::TOK_START_LIST:
+            return datum::LIST;
+
+        case datum::TOK_START_NAME:
+            return datum::NAMED;
+
+        case datum::TOK_CALL:
+            return datum::METHOD;
+
+        case datum::TOK_END_SESSION:
+            return datum::END_SESSION;
+
+        default:
+            return datum::ATOM;
+    }
+}
+
+/**
+ * \brief Locate first list item (list or method call)
+ *
+ * @return Offset of first item, or end of list token
+ */
+size_t datum_view::list_start() const
+{
+    if (data_type == datum::LIST)
+    {
+        return 1;
+    }
+    else if (data_type == datum::METHOD)
+    {
+        // Skip call token, both UIDs, and start of list
+        size_t size = 1;
+        size += atom_view(data + size, len - size).size();
+        size += atom_view(data + size, len - size).size();
+        if ((size >= len) || (data[size] != datum::TOK_START_LIST))
+        {
+            throw topaz_exception("Unexpected token in datum encoding");
+        }
+        return size + 1;
+    }
+
+    throw topaz_exception("Datum has no list");
+}
+
+/**
+ * \brief Check for end of list
+ *
+ * @param size Offset of next list item
+ * @return True if end of list token found there
+ */
+bool datum_view::at_end(size_t size) const
+{
+    // Ensure one more byte
+    if (size >= len)
+    {
+        throw topaz_exception("Datum encoding too short");
+    }
+
+    return (data[size] == datum::TOK_END_LIST);
+}
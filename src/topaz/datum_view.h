@@ -0,0 +1,215 @@
+#ifndef TOPAZ_DATUM_VIEW_H
+#define TOPAZ_DATUM_VIEW_H
+
+/**
+ * Topaz - Datum View
+ *
+ * This class is a read-only view of an encoded TCG Opal data stream item
+ * (atom, named value, list, or method call), sitting in a buffer owned by
+ * someone else. Nothing is decoded until asked for, and walking to a list
+ * item or named value simply skips over the encoded bytes before it, so
+ * picking a few fields out of a large response costs no allocations. The
+ * view is only valid as long as the underlying buffer.
+ *
+ * Copyright (c) 2014, T Parys
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <topaz/atom_view.h>
+#include <topaz/datum.h>
+
+namespace topaz
+{
+
+    class datum_view
+    {
+
+      public:
+
+        /**
+         * \brief Default Constructor (Unset)
+         */
+        datum_view();
+
+        /**
+         * \brief Buffer Constructor
+         *
+         * @param data Location of encoded datum
+         * @param len  Length of buffer
+         */
+        datum_view(byte const *data, size_t len);
+
+        /**
+         * \brief Buffer Constructor
+         *
+         * @param data Buffer holding encoded datum
+         */
+        datum_view(byte_vector const &data);
+
+        /**
+         * \brief Measure encoded datum without decoding it
+         *
+         * @param data Location of encoded datum
+         * @param len  Length of buffer
+         * @return Byte count of datum in buffer
+         */
+        static size_t skip(byte const *data, size_t len);
+
+        /**
+         * \brief Query encoded size (walks whole datum)
+         *
+         * @return Byte count of datum in buffer
+         */
+        size_t size() const;
+
+        /**
+         * \brief Query Datum Type
+         */
+        datum::type_t get_type() const;
+
+        /**
+         * \brief Query Atom Value
+         */
+        atom_view value() const;
+
+        /**
+         * \brief Query Name
+         */
+        atom_view name() const;
+
+        /**
+         * \brief Query Named Value
+         */
+        datum_view named_value() const;
+
+        /**
+         * \brief Query Method's Object UID
+         */
+        uint64_t object_uid() const;
+
+        /**
+         * \brief Query Method's Method UID
+         */
+        uint64_t method_uid() const;
+
+        /**
+         * \brief Query Number of Items in List
+         */
+        size_t count() const;
+
+        /**
+         * \brief Query Named Value in List
+         */
+        datum_view find_by_name(uint64_t id) const;
+
+        /**
+         * \brief Datum array access
+         *
+         * @param idx Item to return
+         * @return Specified item
+         */
+        datum_view operator[](size_t idx) const;
+
+        /**
+         * \brief Step through list items, in a single pass
+         *
+         * @param pos Offset of item, starting from zero (updated to next item)
+         * @param item Item found there
+         * @return False once end of list reached
+         */
+        bool next_item(size_t &pos, datum_view &item) const;
+
+        /**
+         * \brief Step through named values in list, in a single pass
+         *
+         * Other list items are stepped over.
+         *
+         * @param pos Offset of item, starting from zero (updated to next item)
+         * @param name Name of named value found
+         * @param value Value of named value found
+         * @return False once end of list reached
+         */
+        bool next_named(size_t &pos, atom_view &name, datum_view &value) const;
+
+        /**
+         * \brief Get Unsigned Integer Value (Atom)
+         */
+        uint64_t get_uint() const;
+
+        /**
+         * \brief Get Unique ID Value (Atom)
+         */
+        uint64_t get_uid() const;
+
+        /**
+         * \brief Get Copy as Owning Datum
+         */
+        datum get_datum() const;
+
+      protected:
+
+        /**
+         * \brief Measure encoded datum, at given nesting depth
+         *
+         * @param data Location of encoded datum
+         * @param len  Length of buffer
+         * @param depth Nesting depth of datum
+         * @return Byte count of datum in buffer
+         */
+        static size_t skip(byte const *data, size_t len, size_t depth);
+
+        /**
+         * \brief Determine datum type from leading token
+         *
+         * @param tok First byte of encoded datum
+         * @return Type of datum
+         */
+        static datum::type_t classify(byte tok);
+
+        /**
+         * \brief Locate first list item (list or method call)
+         *
+         * @return Offset of first item, or end of list token
+         */
+        size_t list_start() const;
+
+        /**
+         * \brief Check for end of list
+         *
+         * @param size Offset of next list item
+         * @return True if end of list token found there
+         */
+        bool at_end(size_t size) const;
+
+        // Location of encoded datum
+        byte const    *data;
+        size_t         len;       // Bytes of buffer from start of datum
+
+        // What was found there
+        datum::type_t  data_type;
+
+    };
+
+};
+
+#endif
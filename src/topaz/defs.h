@@ -52,6 +52,13 @@ namespace topaz
     // Vector of bytes
     typedef std::vector<byte> byte_vector;
 
+    // Non-owning reference to bytes held elsewhere
+    typedef struct
+    {
+        byte const *ptr;
+        size_t      len;
+    } byte_span_t;
+
     // Vector of atoms (forward declare to avoid circular deps)
     class atom;
     typedef std::vector<atom> atom_vector;
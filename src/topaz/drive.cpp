@@ -30,8 +30,10 @@
 
 #include <unistd.h>
 #define __STDC_FORMAT_MACROS
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
+#include <ctime>
 #include <inttypes.h>
 #include <linux/fs.h>
 #include <topaz/defs.h>
@@ -40,6 +42,7 @@
 #include <topaz/exceptions.h>
 #include <topaz/portable_endian.h>
 #include <topaz/spinner.h>
+#include <topaz/table_iter.h>
 #include <topaz/uid.h>
 using namespace std;
 using namespace topaz;
@@ -55,6 +58,76 @@ using namespace topaz;
 // Max host I/O size (64 kiB + extra 512 B block)
 #define MAX_IO_BLOCKS 129
 
+// Default retry policy for SP_BUSY / NO_SESSIONS_AVAILABLE
+#define RETRY_ATTEMPTS 8
+#define RETRY_BASE_MS  10
+#define RETRY_MAX_MS   1000
+#define RETRY_BUDGET_MS 5000
+
+/**
+ * \brief Monotonic clock, in microseconds
+ */
+static uint64_t now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+/**
+ * \brief Take first item of decoded response, without copying it
+ *
+ * @param resp Decoded response (arena), first item left moved-from
+ * @return First item of response list
+ */
+static datum take_first(datum &resp)
+{
+    // Same checks as const lookup, so a malformed response still throws
+    if (resp.get_type() != datum::LIST)
+    {
+        throw topaz_exception("Datum has no list");
+    }
+    if (resp.list().empty())
+    {
+        throw topaz_exception("Datum list index out of range");
+    }
+
+    return std::move(resp.list()[0]);
+}
+
+/**
+ * \brief Find method status list at tail of response
+ *
+ * Status list is a fixed six bytes (End of Data, then a list of three
+ * tiny atoms), so it is read straight off the end, leaving the response
+ * itself for the decoder to walk (and validate) just once.
+ *
+ * @param bytes  Encoded response, status list included
+ * @param count  Returns length of response, status list excluded
+ * @return Method status
+ */
+static unsigned status_tail(byte_vector const &bytes, size_t &count)
+{
+    // Need at least one byte of response in front of status list
+    if (bytes.size() < 7)
+    {
+        throw topaz_exception("Invalid method status on return");
+    }
+    count = bytes.size() - 6;
+    topaz::byte const *tail = &(bytes[count]);
+
+    // Expect End of Data, then [ status, 0, 0 ] as tiny atoms
+    if ((tail[0] != datum::TOK_END_OF_DATA) ||
+        (tail[1] != datum::TOK_START_LIST) ||
+        (tail[2] > 0x3f) || (tail[3] != 0) || (tail[4] != 0) ||
+        (tail[5] != datum::TOK_END_LIST))
+    {
+        throw topaz_exception("Invalid method status on return");
+    }
+
+    return tail[2];
+}
+
 /**
  * \brief Topaz Hard Drive Constructor
  *
@@ -65,15 +138,32 @@ drive::drive(char const *path)
 {
     // Initialization
     session_is_auth = false;
+    session_is_write = false;
     session_sp = 0;
     tper_session_id = 0;
     host_session_id = 0;
+    cache_enabled = false;
+    cache_hits = 0;
+    cache_misses = 0;
     msg_type = SWG_MSG_UNKNOWN;
     has_proto_reset = false;
     lock_flag = false;
     lba_align = 1;
     com_id = 0;
     raw_buffer.resize(1024); // Until otherwise identified
+    tper_max_packet = raw_buffer.size() - sizeof(opal_com_packet_header_t);
+    tper_max_methods = 1;    // Only value Opal guarantees
+
+    // Resource contention on the drive is worth waiting out
+    retry_policy_t busy = { RETRY_ATTEMPTS, RETRY_BASE_MS, RETRY_MAX_MS,
+                            RETRY_BUDGET_MS, false };
+    retry_policies[datum::STA_SP_BUSY] = busy;
+    retry_policies[datum::STA_NO_SESSIONS_AVAILABLE] = busy;
+    memset(&retry_stats, 0, sizeof(retry_stats));
+    call_timeout_ms = TIMEOUT_SECS * 1000;
+    call_timeouts = 0;
+    comid_stale = false;
+    retry_rng.seed(now_us() ^ getpid());
 
     // Check for drive TPM
     probe_tpm();
@@ -165,8 +255,9 @@ uint64_t drive::get_max_users()
  * \brief Combined I/O to TCG Opal drive
  *
  * @param sp_uid Target Security Provider for session (ADMIN_SP / LOCKING_SP)
+ * @param write Request Read/Write session (false for read-only queries)
  */
-void drive::login_anon(uint64_t sp_uid)
+void drive::login_anon(uint64_t sp_uid, bool write)
 {
     // If present, end any session in progress
     logout();
@@ -175,13 +266,14 @@ void drive::login_anon(uint64_t sp_uid)
     datum params;
     params[0].value()   = atom::new_uint(getpid()); // Host Session ID (Process ID)
     params[1].value()   = atom::new_uid(sp_uid);    // Admin SP or Locking SP
-    params[2].value()   = atom::new_uint(1);        // Read/Write Session
+    params[2].value()   = atom::new_uint(write);    // Read/Write or Read-Only
 
     // Off it goes
     datum rc = invoke(SESSION_MGR, START_SESSION, params);
 
     // Session tracking
     session_is_auth = false;
+    session_is_write = write;
     session_sp = sp_uid;
 
     // Host session ID
@@ -191,8 +283,8 @@ void drive::login_anon(uint64_t sp_uid)
     tper_session_id = rc[1].value().get_uint();
 
     // Debug
-    TOPAZ_DEBUG(1) printf("Anonymous Session %" PRIx64 ":%" PRIx64 " Started\n",
-                          tper_session_id, host_session_id);
+    TOPAZ_DEBUG(1) printf("Anonymous %s Session %" PRIx64 ":%" PRIx64 " Started\n",
+                          (write ? "R/W" : "R/O"), tper_session_id, host_session_id);
 }
 
 /**
@@ -200,17 +292,40 @@ void drive::login_anon(uint64_t sp_uid)
  *
  * @param sp_uid Target Security Provider for session (ADMIN_SP / LOCKING_SP)
  * @param user_uid
+ * @param write Request Read/Write session (false for read-only queries)
  */
-void drive::login(uint64_t sp_uid, uint64_t auth_uid, string pin)
+void drive::login(uint64_t sp_uid, uint64_t auth_uid, string pin, bool write)
 {
+    // Most likely the wrong PIN, but the drive says otherwise when not
+    if (try_login(sp_uid, auth_uid, pin, write) != datum::STA_SUCCESS)
+    {
+        throw topaz_exception("Login failure");
+    }
+}
+
+/**
+ * \brief Authenticated login, without throwing on refusal
+ *
+ * @param sp_uid Target Security Provider for session (ADMIN_SP / LOCKING_SP)
+ * @param auth_uid Authority to log in as
+ * @param pin Credentials of authority
+ * @param write Request Read/Write session (false for read-only queries)
+ * @return Status reported by drive (eg - STA_NOT_AUTHORIZED for wrong PIN)
+ */
+datum::status_t drive::try_login(uint64_t sp_uid, uint64_t auth_uid, string const &pin,
+                                 bool write)
+{
+    datum::status_t status;
+    datum_view rc;
+
     // If present, end any session in progress
     logout();
 
     // Parameters - Required Arguments (Simple Atoms)
-    datum params, rc;
+    datum params;
     params[0].value()   = atom::new_uint(getpid()); // Host Session ID (Process ID)
     params[1].value()   = atom::new_uid(sp_uid);    // Admin SP or Locking SP
-    params[2].value()   = atom::new_uint(1);        // Read/Write Session
+    params[2].value()   = atom::new_uint(write);    // Read/Write or Read-Only
 
     // Optional Arguments (Named Atoms)
     params[3].name()        = atom::new_uint(0);       // Host Challenge
@@ -219,32 +334,29 @@ void drive::login(uint64_t sp_uid, uint64_t auth_uid, string pin)
     params[4].named_value() = atom::new_uid(auth_uid);
 
     // Off it goes
-    try
-    {
-        rc = invoke(SESSION_MGR, START_SESSION, params);
-    }
-    catch (topaz_exception &e)
+    status = try_invoke(SESSION_MGR, START_SESSION, params, rc);
+    if (status != datum::STA_SUCCESS)
     {
-        // There's a bunch of things that could happen here, but the
-        // most likely is a login failure. Without reworking the library's
-        // entire exception handling, this is a quick fix to a horribly
-        // misnamed exception thrown when the wrong PIN is entered.
-        throw topaz_exception("Login failure");
+        TOPAZ_DEBUG(1) printf("Login Refused (status %u)\n", (unsigned)status);
+        return status;
     }
 
     // Session tracking
     session_is_auth = true;
+    session_is_write = write;
     session_sp = sp_uid;
 
     // Host session ID
-    host_session_id = rc[0].value().get_uint();
+    host_session_id = rc[0].get_uint();
 
     // TPer session ID
-    tper_session_id = rc[1].value().get_uint();
+    tper_session_id = rc[1].get_uint();
 
     // Debug
-    TOPAZ_DEBUG(1) printf("Authorized Session %" PRIx64 ":%" PRIx64 " Started\n",
-                          tper_session_id, host_session_id);
+    TOPAZ_DEBUG(1) printf("Authorized %s Session %" PRIx64 ":%" PRIx64 " Started\n",
+                          (write ? "R/W" : "R/O"), tper_session_id, host_session_id);
+
+    return status;
 }
 
 /**
@@ -257,6 +369,11 @@ void drive::logout()
         // Debug
         TOPAZ_DEBUG(1) printf("Stopping TPM Session %" PRIx64 ":%" PRIx64 "\n",
                               tper_session_id, host_session_id);
+        TOPAZ_DEBUG(2) if (cache_enabled)
+        {
+            printf("  Get Cache: %" PRIu64 " hits, %" PRIu64 " misses\n",
+                   cache_hits, cache_misses);
+        }
 
         // Off it goes
         try
@@ -290,6 +407,16 @@ bool drive::get_session_auth() const
     return session_is_auth;
 }
 
+/**
+ * \brief Query if writable session
+ *
+ * @return True if Read/Write session is active, false otherwise
+ */
+bool drive::get_session_write() const
+{
+    return session_is_write;
+}
+
 /**
  * \brief Query for session SP
  *
@@ -331,10 +458,10 @@ datum drive::table_get(uint64_t tbl_uid)
     params[0] = datum(datum::LIST); // Empty list
 
     // Method Call - UID.Get[]
-    datum rc = invoke(tbl_uid, GET, params);
+    invoke_arena(tbl_uid, GET, params);
 
-    // Return first element of nested array
-    return rc[0];
+    // Hand first element of nested array over, rather than copying it
+    return take_first(arena_resp);
 }
 
 /**
@@ -346,18 +473,68 @@ datum drive::table_get(uint64_t tbl_uid)
  */
 atom drive::table_get(uint64_t tbl_uid, uint64_t tbl_col)
 {
-    // Parameters - Required Arguments (Simple Atoms)
+    // Method Call - UID.Get[Cellblock(startColumn, endColumn)]
+    datum_view rc = invoke_view(swg::call(tbl_uid, GET,
+                                          swg::cellblock(swg::start_col(tbl_col),
+                                                         swg::end_col(tbl_col))));
+
+    // Return first element of nested array (only part decoded)
+    return rc[0][0].named_value().value().get_atom();
+}
+
+/**
+ * \brief Query Range of Values from Specified Table
+ *
+ * @param tbl_uid Identifier of target table
+ * @param start_col First column of data to retrieve (table specific)
+ * @param end_col Last column of data to retrieve (table specific)
+ * @return List of named values, one per column present
+ */
+datum drive::table_get(uint64_t tbl_uid, uint64_t start_col, uint64_t end_col)
+{
+    // Method Call - UID.Get[Cellblock(startColumn, endColumn)]
+    decode_response(arena_resp, invoke_raw(swg::call(tbl_uid, GET,
+                                                     swg::cellblock(swg::start_col(start_col),
+                                                                    swg::end_col(end_col)))));
+
+    // Hand first element of nested array over, rather than copying it
+    return take_first(arena_resp);
+}
+
+/**
+ * \brief Query Rows Present in Object Table
+ *
+ * @param tbl_uid Identifier of target table
+ * @param where Row to start after (0 for beginning of table)
+ * @param count Maximum number of rows to return
+ * @param uids Storage for row UIDs found
+ */
+void drive::table_next(uint64_t tbl_uid, uint64_t where, uint64_t count,
+                       vector<uint64_t> &uids)
+{
+    // Parameters - Optional Arguments (Named Atoms)
     datum params;
-    params[0][0].name()        = atom::new_uint(3);       // Starting Table Column
-    params[0][0].named_value() = atom::new_uint(tbl_col);
-    params[0][1].name()        = atom::new_uint(4);       // Ending Tabling Column
-    params[0][1].named_value() = atom::new_uint(tbl_col);
+    size_t idx = 0;
+    if (where)
+    {
+        params[idx].name()        = atom::new_uint(0);       // Where
+        params[idx].named_value() = atom::new_uid(where);
+        idx++;
+    }
+    params[idx].name()        = atom::new_uint(1);           // Count
+    params[idx].named_value() = atom::new_uint(count);
 
-    // Method Call - UID.Get[]
-    datum rc = invoke(tbl_uid, GET, params);
+    // Method Call - Table.Next[]
+    datum_view rc = invoke_view(tbl_uid, NEXT, params);
 
-    // Return first element of nested array
-    return rc[0][0].named_value().value();
+    // Result is a list of row UIDs (walked once, front to back)
+    datum_view rows = rc[0], row;
+    size_t pos = 0;
+    uids.clear();
+    while (rows.next_item(pos, row))
+    {
+        uids.push_back(row.get_uid());
+    }
 }
 
 /**
@@ -368,28 +545,40 @@ void drive::table_get_bin(uint64_t tbl_uid, uint64_t offset,
                           void *ptr, uint64_t len)
 {
     char *out_ptr = (char*)ptr;
+    uint64_t xfer_len = bin_xfer_size(tbl_uid);
 
     while (len > 0)
     {
         // Make sure I/O size isn't too big ...
-        uint64_t read_len = (len > max_token ? max_token : len);
+        uint64_t read_len = (len > xfer_len ? xfer_len : len);
 
         // Last byte to read
         uint64_t end_byte = offset + read_len - 1;
 
-        // Cook up parameter list for table set
-        datum params;
-        params[0][0].name()        = atom::new_uint(1);             // Start row
-        params[0][0].named_value() = atom::new_uint(offset);        // Offset of 0
-        params[0][1].name()        = atom::new_uint(2);             // End row
-        params[0][1].named_value() = atom::new_uint(end_byte);      // Data
+        // Invoke method - UID.Get[Cellblock(startRow, endRow)]
+        datum_view rc = invoke_view(swg::call(tbl_uid, GET,
+                                              swg::cellblock(swg::start_row(offset),
+                                                             swg::end_row(end_byte))));
 
-        // Invoke method
-        datum rc = invoke(tbl_uid, GET, params);
-
-        // Copy data out
-        byte_vector const &rc_data = rc[0].value().get_bytes();
-        memcpy(out_ptr, &(rc_data[0]), read_len);
+        // Copy data straight out of response buffer (a fragment at a time,
+        // should the drive have split it up)
+        atom_view rc_data = rc[0].value();
+        if (rc_data.get_length() < read_len)
+        {
+            throw topaz_exception("Short read from binary table");
+        }
+        byte_span_t frag;
+        size_t done = 0;
+        for (size_t pos = 0; done < read_len; )
+        {
+            pos = rc_data.next_fragment(pos, frag);
+            size_t copy_len = (frag.len < read_len - done ? frag.len : read_len - done);
+            if (copy_len)
+            {
+                memcpy(out_ptr + done, frag.ptr, copy_len);
+            }
+            done += copy_len;
+        }
 
         // update pointers
         out_ptr += read_len;
@@ -405,16 +594,29 @@ void drive::table_get_bin(uint64_t tbl_uid, uint64_t offset,
  * @param tbl_col Column number of data to retrieve (table specific)
  * @param val Value to set in column
  */
-void drive::table_set(uint64_t tbl_uid, uint64_t tbl_col, datum val)
+void drive::table_set(uint64_t tbl_uid, uint64_t tbl_col, datum const &val)
+{
+    // One copy of caller's value, moved into place from there
+    table_set(tbl_uid, tbl_col, datum(val));
+}
+
+/**
+ * \brief Set Value in Specified Table (value taken over)
+ *
+ * @param tbl_uid Identifier of target table
+ * @param tbl_col Column number of data to retrieve (table specific)
+ * @param val Value to set in column
+ */
+void drive::table_set(uint64_t tbl_uid, uint64_t tbl_col, datum &&val)
 {
     // Parameters - Required Arguments (Simple Atoms)
     datum params;
     params[0].name()                         = atom::new_uint(1);       // Values
     params[0].named_value()[0].name()        = atom::new_uint(tbl_col);
-    params[0].named_value()[0].named_value() = val;
+    params[0].named_value()[0].named_value() = std::move(val);
 
     // Method Call - UID.Set[]
-    datum rc = invoke(tbl_uid, SET, params);
+    invoke_arena(tbl_uid, SET, params);
 }
 
 /**
@@ -426,8 +628,9 @@ void drive::table_set(uint64_t tbl_uid, uint64_t tbl_col, datum val)
  */
 void drive::table_set(uint64_t tbl_uid, uint64_t tbl_col, uint64_t val)
 {
-    // Convenience / clarity wrapper ...
-    table_set(tbl_uid, tbl_col, atom::new_uint(val));
+    // Method Call - UID.Set[Values = [column = val]]
+    invoke_raw(swg::call(tbl_uid, SET,
+                         swg::values(swg::list(swg::column(tbl_col, swg::uint(val))))));
 }
 
 /**
@@ -437,7 +640,7 @@ void drive::table_set(uint64_t tbl_uid, uint64_t tbl_col, uint64_t val)
  * @param tbl_col Column number of data to retrieve (table specific)
  * @param val Value to set in column
  */
-void drive::table_set(uint64_t tbl_uid, uint64_t tbl_col, string val)
+void drive::table_set(uint64_t tbl_uid, uint64_t tbl_col, string const &val)
 {
     // Convenience / clarity wrapper ...
     byte const *ptr = (byte const*)(val.c_str());
@@ -456,23 +659,18 @@ void drive::table_set_bin(uint64_t tbl_uid, uint64_t offset,
                           void const *ptr, uint64_t len)
 {
     byte const *raw = (byte const *)ptr;
-    uint64_t send_size;
+    uint64_t send_size, xfer_len = bin_xfer_size(tbl_uid);
 
     // Send data in one or more chunks
     while (len)
     {
         // Next send is at most max_token
-        send_size = (len > max_token ? max_token : len);
+        send_size = (len > xfer_len ? xfer_len : len);
 
-        // Cook up parameter list for table set
-        datum params;
-        params[0].name()        = atom::new_uint(0);             // Where
-        params[0].named_value() = atom::new_uint(offset);        // Offset of 0
-        params[1].name()        = atom::new_uint(1);             // Values
-        params[1].named_value() = atom::new_bin(raw, send_size); // Data
-
-        // Invoke method
-        invoke(tbl_uid, SET, params);
+        // Invoke method - UID.Set[Where = offset, Values = data]
+        // (data encoded straight from caller's buffer, never copied)
+        invoke_raw(swg::call(tbl_uid, SET, swg::where(offset),
+                             swg::values(swg::bin(raw, send_size))));
 
         // Bump counters, pointers
         len    -= send_size;
@@ -493,7 +691,6 @@ void drive::table_set_bin_file(uint64_t tbl_uid, uint64_t offset,
 {
     FILE *in_file;
     size_t file_len, count;
-    uint64_t desc_uid;
     uint64_t table_size;
 
     // Open input file
@@ -510,9 +707,7 @@ void drive::table_set_bin_file(uint64_t tbl_uid, uint64_t offset,
     printf("File length is %lu\n", (unsigned long)file_len);
 
     // Let's pull open the table descriptor
-    desc_uid = _UID_MAKE(1, _UID_HIGH(tbl_uid));
-    table_get(desc_uid);
-    table_size = table_get(desc_uid, 7).get_uint();
+    table_size = get_table_desc(tbl_uid).rows;
     printf("Table size is is %lu\n", (unsigned long)table_size);
 
     // Sanity check
@@ -522,8 +717,7 @@ void drive::table_set_bin_file(uint64_t tbl_uid, uint64_t offset,
     }
 
     // The drive may suggest an optimal access granularity
-    size_t optimal = table_get(desc_uid, 14).get_uint();
-    size_t xfer_len = max_token / optimal * optimal;
+    size_t xfer_len = bin_xfer_size(tbl_uid);
 
     // How many blocks are we moving?
     size_t xfer_count = 1 + (file_len - 1) / xfer_len;
@@ -554,20 +748,105 @@ void drive::table_set_bin_file(uint64_t tbl_uid, uint64_t offset,
 }
 
 /**
- * \brief Retrieve default device PIN
+ * \brief Query Table Descriptor
+ *
+ * Descriptors are read once per session, and kept in a catalog
+ * for any further queries.
+ *
+ * @param tbl_uid Identifier of target table
+ * @return Descriptor of table
  */
-string drive::default_pin()
+table_desc_t const &drive::get_table_desc(uint64_t tbl_uid)
+{
+    // Already know about this one?
+    uint64_t tbl_id = _UID_HIGH(tbl_uid);
+    unordered_map<uint64_t, table_desc_t>::const_iterator iter = table_catalog.find(tbl_id);
+    if (iter != table_catalog.end())
+    {
+        return iter->second;
+    }
+
+    // Descriptor lives in the Table table, row is the table's high UID
+    return add_table_desc(tbl_id, table_get(_UID_MAKE(1, tbl_id)));
+}
+
+/**
+ * \brief Load Every Table Descriptor
+ *
+ * Walk the Table table to fill the session catalog in a few
+ * round trips, rather than one per table on first use.
+ */
+void drive::load_table_catalog()
+{
+    table_iter iter(*this, TABLE_TABLE, true);
+    while (iter.next())
+    {
+        add_table_desc(_UID_LOW(iter.get_uid()), iter.get_row());
+    }
+}
+
+/**
+ * \brief Add row of Table table to session catalog
+ *
+ * @param tbl_id High UID of described table
+ * @param row Columns of descriptor row
+ * @return Catalog entry
+ */
+table_desc_t const &drive::add_table_desc(uint64_t tbl_id, datum const &row)
 {
-    // MSID PIN is encoded as a byte_vector atom
-    byte_vector pin_bytes = table_get(C_PIN_MSID, 3).get_bytes();
+    // Pull the interesting bits in a single pass (not all are mandatory)
+    table_desc_t desc = {_UID_MAKE(tbl_id, 0), 0, 0, 0, 0};
+    datum_vector const &cols = row.list();
+    for (size_t i = 0; i < cols.size(); i++)
+    {
+        if ((cols[i].get_type() != datum::NAMED) ||
+            (cols[i].name().get_type() != atom::UINT) ||
+            (cols[i].named_value().get_type() != datum::ATOM) ||
+            (cols[i].named_value().value().get_type() != atom::UINT))
+        {
+            continue;
+        }
+
+        uint64_t val = cols[i].named_value().value().get_uint();
+        switch (cols[i].name().get_uint())
+        {
+            case 4:
+                desc.kind = val;
+                break;
+
+            case 7:
+                desc.rows = val;
+                break;
 
-    // Reroll to string
-    string pin;
-    for (size_t i = 0; i < pin_bytes.size(); i++)
+            case 13:
+                desc.write_gran = val;
+                break;
+
+            case 14:
+                desc.access_gran = val;
+                break;
+        }
+    }
+
+    // Debug
+    TOPAZ_DEBUG(2)
     {
-        pin += pin_bytes[i];
+        printf("Table %" PRIx64 ": kind %" PRIu64 ", rows %" PRIu64
+               ", granularity %" PRIu64 " / %" PRIu64 "\n", tbl_id, desc.kind,
+               desc.rows, desc.write_gran, desc.access_gran);
     }
 
+    return table_catalog[tbl_id] = desc;
+}
+
+/**
+ * \brief Retrieve default device PIN
+ */
+string drive::default_pin()
+{
+    // MSID PIN is encoded as a binary atom
+    string pin = table_get(C_PIN_MSID, 3).get_string();
+
     // Completed PIN as string
     return pin;
 }
@@ -580,56 +859,318 @@ string drive::default_pin()
  * \param params Parameters for method call
  * \return Any data returned from method call
  */
-datum drive::invoke(uint64_t object_uid, uint64_t method_uid, datum params)
+datum drive::invoke(uint64_t object_uid, uint64_t method_uid, datum const &params)
+{
+    // Caller keeps the response, so decode it straight into storage of
+    // its own (leaving the arena's decoded tree for invoke_arena())
+    datum rc;
+    decode_response(rc, invoke_raw(object_uid, method_uid, params));
+    return rc;
+}
+
+/**
+ * \brief Method invocation, response kept in per-invoke arena
+ *
+ * Encoded call, raw response, and decoded response tree all live in
+ * storage owned by the drive, which is reused from one call to the next
+ * rather than freed. Once warmed up with a given shape of call, this
+ * makes repeated invocations (nearly) allocation free.
+ *
+ * \param object_uid UID indicating object to use for invocation
+ * \param method_uid UID indicating method to call on object
+ * \param params List datum with parameters for method call
+ * \return Data returned from method call (valid until next call)
+ */
+datum const &drive::invoke_arena(uint64_t object_uid, uint64_t method_uid,
+                                 datum const &params)
+{
+    // Decode response (over top of the last one)
+    decode_response(arena_resp, invoke_raw(object_uid, method_uid, params));
+    return arena_resp;
+}
+
+/**
+ * \brief Method invocation, response left encoded
+ *
+ * Cheapest way to pick a few fields out of a response, as nothing is
+ * decoded or copied until asked for.
+ *
+ * \param object_uid UID indicating object to use for invocation
+ * \param method_uid UID indicating method to call on object
+ * \param params List datum with parameters for method call
+ * \return View of data returned from method call (valid until next call)
+ */
+datum_view drive::invoke_view(uint64_t object_uid, uint64_t method_uid,
+                              datum const &params)
+{
+    return view_response(invoke_raw(object_uid, method_uid, params));
+}
+
+/**
+ * \brief Method invocation, returning encoded response
+ *
+ * \param object_uid UID indicating object to use for invocation
+ * \param method_uid UID indicating method to call on object
+ * \param params List datum with parameters for method call
+ * \return Encoded response, less method status (valid until next call)
+ */
+byte_vector const &drive::invoke_raw(uint64_t object_uid, uint64_t method_uid,
+                                     datum const &params)
 {
-    // Set up basic method call
-    datum call;
-    call.object_uid() = object_uid;
-    call.method_uid() = method_uid;
-    call.list()       = params.list();
+    return invoke_encoded(object_uid, method_uid,
+                          encode_call(object_uid, method_uid, params));
+}
+
+/**
+ * \brief Method invocation, without throwing on method failure
+ *
+ * \param object_uid UID indicating object to use for invocation
+ * \param method_uid UID indicating method to call on object
+ * \param params List datum with parameters for method call
+ * \return Status reported by method (STA_SUCCESS on success)
+ */
+datum::status_t drive::try_invoke(uint64_t object_uid, uint64_t method_uid,
+                                  datum const &params)
+{
+    datum_view rc;
+    return try_invoke(object_uid, method_uid, params, rc);
+}
+
+/**
+ * \brief Method invocation, without throwing on method failure
+ *
+ * \param object_uid UID indicating object to use for invocation
+ * \param method_uid UID indicating method to call on object
+ * \param params List datum with parameters for method call
+ * \param rc View of data returned on success (valid until next call)
+ * \return Status reported by method (STA_SUCCESS on success)
+ */
+datum::status_t drive::try_invoke(uint64_t object_uid, uint64_t method_uid,
+                                  datum const &params, datum_view &rc)
+{
+    byte_vector const *resp;
+    datum::status_t status;
+
+    status = invoke_status(object_uid, method_uid,
+                           encode_call(object_uid, method_uid, params), resp);
+    rc = (status == datum::STA_SUCCESS ? view_response(*resp) : datum_view());
+    return status;
+}
+
+/**
+ * \brief Encode method call into arena
+ *
+ * \param object_uid UID indicating object to use for invocation
+ * \param method_uid UID indicating method to call on object
+ * \param params List datum with parameters for method call
+ * \return Bytes of encoded call at start of arena
+ */
+size_t drive::encode_call(uint64_t object_uid, uint64_t method_uid, datum const &params)
+{
+    byte_vector &bytes = arena_bytes;
+    size_t param_size, count;
+
+    // Parameters must be a list (or nothing at all)
+    if (params.get_type() == datum::LIST)
+    {
+        param_size = params.size();
+    }
+    else if (params.get_type() == datum::UNSET)
+    {
+        param_size = 2;
+    }
+    else
+    {
+        throw topaz_exception("Method parameters must be a list");
+    }
+
+    // Encode method call straight into arena, with room for status list
+    bytes.resize(19 + param_size + 6);
+    count = 0;
+    bytes[count++] = datum::TOK_CALL;
+    memcpy(&(bytes[count]), uid_token(object_uid).bytes, sizeof(uid_token_t));
+    count += sizeof(uid_token_t);
+    memcpy(&(bytes[count]), uid_token(method_uid).bytes, sizeof(uid_token_t));
+    count += sizeof(uid_token_t);
+    if (params.get_type() == datum::LIST)
+    {
+        count += params.encode_bytes(&(bytes[count]));
+    }
+    else
+    {
+        bytes[count++] = datum::TOK_START_LIST;
+        bytes[count++] = datum::TOK_END_LIST;
+    }
+
+    return count;
+}
+
+/**
+ * \brief Method invocation, call already encoded in arena
+ *
+ * \param object_uid UID indicating object to use for invocation
+ * \param method_uid UID indicating method to call on object
+ * \param call_size Bytes of encoded call at start of arena
+ * \return Encoded response, less method status (valid until next call)
+ */
+byte_vector const &drive::invoke_encoded(uint64_t object_uid, uint64_t method_uid,
+                                         size_t call_size)
+{
+    byte_vector const *resp;
+
+    // Fail out
+    datum::status_t status = invoke_status(object_uid, method_uid, call_size, resp);
+    if (status != datum::STA_SUCCESS)
+    {
+        throw topaz_exception("Method call failed");
+    }
+
+    return *resp;
+}
+
+/**
+ * \brief Method invocation, call already encoded in arena
+ *
+ * Only problems talking to the drive (or making sense of what it says)
+ * are thrown; method failure is left to the caller.
+ *
+ * \param object_uid UID indicating object to use for invocation
+ * \param method_uid UID indicating method to call on object
+ * \param call_size Bytes of encoded call at start of arena
+ * \param resp Encoded response on success, less method status (valid until next call)
+ * \return Status reported by method
+ */
+datum::status_t drive::invoke_status(uint64_t object_uid, uint64_t method_uid,
+                                     size_t call_size, byte_vector const *&resp)
+{
+    byte_vector &bytes = arena_bytes;
+    size_t param_size = call_size - 19, count = call_size;
+    cache_key_t key;
 
     // Debug
     TOPAZ_DEBUG(3)
     {
         printf("SWG Call: ");
-        call.print();
+        atom::new_uid(object_uid).print();
+        printf(".");
+        atom::new_uid(method_uid).print();
+        datum_view(&(bytes[19]), param_size).get_datum().print();
         printf("\n");
     }
 
-    // Convert to byte vector
-    byte_vector bytes = call.encode_vector();
-
     // Tack on method status / control code (TBD - Something cleaner?)
-    bytes.push_back(datum::TOK_END_OF_DATA);
-    bytes.push_back(datum::TOK_START_LIST);
-    bytes.push_back(0); // 0 for execute, some values cancel operations .. (TBD?)
-    bytes.push_back(0); // Reserved
-    bytes.push_back(0); // Reserved
-    bytes.push_back(datum::TOK_END_LIST);
-
-    // Send packet to drive.
-    // NOTE: Session manager is stateless and doesn't use session ID's ...
-    send(bytes, (object_uid != SESSION_MGR));
-
-    // Gather response
-    recv(bytes);
+    bytes.resize(call_size + 6);
+    bytes[count++] = datum::TOK_END_OF_DATA;
+    bytes[count++] = datum::TOK_START_LIST;
+    bytes[count++] = 0; // 0 for execute, some values cancel operations .. (TBD?)
+    bytes[count++] = 0; // Reserved
+    bytes[count++] = 0; // Reserved
+    bytes[count++] = datum::TOK_END_LIST;
+
+    // Get[] may already have an answer in session cache
+    if (cache_enabled && (method_uid == GET))
+    {
+        key.first = object_uid;
+        key.second.assign(bytes.begin() + 19, bytes.begin() + 19 + param_size);
 
-    // Decode response
-    datum rc;
-    size_t count = rc.decode_vector(bytes);
+        map<cache_key_t, byte_vector>::const_iterator hit = get_cache.find(key);
+        if (hit != get_cache.end())
+        {
+            cache_hits++;
 
-    // Check status code (TBD - Clean this up)
-    if (bytes.size() - count != 6)
+            // Debug
+            TOPAZ_DEBUG(3)
+            {
+                printf("SWG Cached : ");
+                datum_view(hit->second).get_datum().print();
+                printf("\n");
+            }
+
+            resp = &(hit->second);
+            return datum::STA_SUCCESS;
+        }
+        cache_misses++;
+    }
+    else
     {
-        throw topaz_exception("Invalid method status on return");
+        // Anything else may change what Get[] would return
+        cache_invalidate(object_uid, method_uid);
+    }
+
+    // Response overwrites arena, so keep a copy of the call if any
+    // policy may need it sent again
+    bool may_retry = false;
+    map<unsigned, retry_policy_t>::const_iterator pol;
+    for (pol = retry_policies.begin(); pol != retry_policies.end(); pol++)
+    {
+        may_retry |= ((pol->second.max_attempts > 1) &&
+                      (pol->second.replay_writes || is_idempotent(method_uid)));
+    }
+    if (may_retry)
+    {
+        retry_bytes.assign(bytes.begin(), bytes.end());
+    }
+
+    // Deadline covers whole call, retries included
+    uint64_t deadline = now_us() + (uint64_t)call_timeout_ms * 1000;
+
+    unsigned status, attempt = 0;
+    uint64_t waited_us = 0;
+    while (true)
+    {
+        // Send packet to drive.
+        // NOTE: Session manager is stateless and doesn't use session ID's ...
+        send(bytes, (object_uid != SESSION_MGR));
+
+        // Gather response (give up on call past its deadline)
+        if (!try_recv(bytes, deadline))
+        {
+            abandon_call();
+        }
+
+        // Peel method status off the end, without decoding response
+        status = status_tail(bytes, count);
+        attempt++;
+
+        // Done, unless the drive asked us to come back later
+        long delay_ms = -1;
+        if (status && may_retry)
+        {
+            delay_ms = retry_delay(status, method_uid, attempt, waited_us / 1000);
+        }
+        if ((delay_ms >= 0) && (now_us() + (uint64_t)delay_ms * 1000 >= deadline))
+        {
+            delay_ms = -1;
+        }
+        if (delay_ms < 0)
+        {
+            if (attempt > 1)
+            {
+                if (status) retry_stats.gave_up++;
+                else        retry_stats.recovered++;
+            }
+            break;
+        }
+
+        // Debug
+        TOPAZ_DEBUG(1) printf("Method status %u, retry %u in %ld ms\n",
+                              status, attempt, delay_ms);
+
+        // Back off, then restore call for another go
+        uint64_t start = now_us();
+        usleep(delay_ms * 1000);
+        uint64_t slept = now_us() - start;
+        waited_us += slept;
+        retry_stats.wait_us += slept;
+        retry_stats.retries++;
+        bytes.assign(retry_bytes.begin(), retry_bytes.end());
     }
-    unsigned status = bytes[count + 2];
 
     // Debug
     TOPAZ_DEBUG(3)
     {
         printf("SWG Return : ");
-        rc.print();
+        datum_view(&(bytes[0]), count).get_datum().print();
         if (status)
         {
             printf(" <STATUS=%u>", status);
@@ -637,13 +1178,286 @@ datum drive::invoke(uint64_t object_uid, uint64_t method_uid, datum params)
         printf("\n");
     }
 
-    // Fail out
+    // Leave failure to caller
     if (status)
     {
-        throw topaz_exception("Method call failed");
+        return (datum::status_t)status;
     }
 
-    return rc;
+    // Drop status list (storage retained for next call)
+    bytes.resize(count);
+
+    // Remember Get[] response for rest of session (still encoded)
+    if (cache_enabled && (method_uid == GET))
+    {
+        get_cache[key] = bytes;
+    }
+
+    resp = &bytes;
+    return datum::STA_SUCCESS;
+}
+
+/**
+ * \brief Enable / disable session cache of Get[] responses
+ *
+ * @param enable True to enable cache, false to disable (and clear)
+ */
+void drive::set_get_cache(bool enable)
+{
+    cache_enabled = enable;
+    if (!enable)
+    {
+        get_cache.clear();
+    }
+}
+
+/**
+ * \brief Set retry policy for a method status
+ *
+ * @param status Method status to apply policy to
+ * @param policy Retry parameters (max_attempts of 1 disables retry)
+ */
+void drive::set_retry_policy(datum::status_t status, retry_policy_t const &policy)
+{
+    if (policy.max_attempts > 1)
+    {
+        retry_policies[status] = policy;
+    }
+    else
+    {
+        retry_policies.erase(status);
+    }
+}
+
+/**
+ * \brief Query retry policy for a method status
+ *
+ * @param status Method status to look up
+ * @return Retry parameters (max_attempts of 1 if not retried)
+ */
+retry_policy_t drive::get_retry_policy(datum::status_t status) const
+{
+    map<unsigned, retry_policy_t>::const_iterator iter = retry_policies.find(status);
+    if (iter == retry_policies.end())
+    {
+        retry_policy_t none = { 1, 0, 0, 0, false };
+        return none;
+    }
+
+    return iter->second;
+}
+
+/**
+ * \brief Set deadline for each method call
+ *
+ * @param timeout_ms Milliseconds to wait for each call to complete
+ */
+void drive::set_call_timeout(unsigned timeout_ms)
+{
+    call_timeout_ms = timeout_ms;
+}
+
+/**
+ * \brief Query deadline for each method call
+ */
+unsigned drive::get_call_timeout() const
+{
+    return call_timeout_ms;
+}
+
+/**
+ * \brief Query retry counters
+ */
+retry_stats_t const &drive::get_retry_stats() const
+{
+    return retry_stats;
+}
+
+/**
+ * \brief Abandon method call which missed its deadline
+ *
+ * Once the drive has the whole call, there is no canceling it with the
+ * method status list, so reset the ComID stack instead. The response
+ * (if it ever comes) goes with it, along with any open session. Without
+ * STACK_RESET, the TPer still owes that response, and would hand it to
+ * whatever is sent next, so the drive is marked unusable instead.
+ *
+ * Always throws topaz_timeout.
+ */
+void drive::abandon_call()
+{
+    // Debug
+    TOPAZ_DEBUG(1) printf("Method call timed out after %u ms\n", call_timeout_ms);
+
+    // STACK_RESET, if the drive supports it
+    if (has_proto_reset)
+    {
+        reset_comid(com_id);
+    }
+    else
+    {
+        comid_stale = true;
+    }
+    forget_session();
+    call_timeouts++;
+
+    throw topaz_timeout("Timeout waiting for response");
+}
+
+/**
+ * \brief Query number of method calls abandoned at deadline
+ */
+uint64_t drive::get_call_timeouts() const
+{
+    return call_timeouts;
+}
+
+/**
+ * \brief Check if method may be safely sent again
+ *
+ * @param method_uid UID of method being invoked
+ * @return False for methods which change (or may change) drive state
+ */
+bool drive::is_idempotent(uint64_t method_uid)
+{
+    // Only methods known not to change drive state (anything else,
+    // including methods we've never heard of, is assumed to)
+    switch (method_uid)
+    {
+        case GET:
+        case NEXT:
+        case PROPERTIES:
+        case START_SESSION:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/**
+ * \brief Pick backoff before retrying a failed method call
+ *
+ * Full jitter: a uniform pick below a ceiling which doubles with each
+ * try, so callers contending for the same drive spread out.
+ *
+ * @param status Status reported by failed call
+ * @param method_uid UID of method being invoked
+ * @param attempt Number of tries made so far
+ * @param waited_ms Time already spent in backoff for this call
+ * @return Delay in milliseconds, or -1 to give up
+ */
+long drive::retry_delay(unsigned status, uint64_t method_uid, unsigned attempt,
+                        uint64_t waited_ms)
+{
+    map<unsigned, retry_policy_t>::const_iterator iter = retry_policies.find(status);
+    if (iter == retry_policies.end())
+    {
+        return -1;
+    }
+    retry_policy_t const &policy = iter->second;
+
+    // Don't blindly repeat something that may have half happened
+    if (!policy.replay_writes && !is_idempotent(method_uid))
+    {
+        retry_stats.skipped++;
+        return -1;
+    }
+
+    // Out of tries, or out of time
+    if ((attempt >= policy.max_attempts) || (waited_ms >= policy.budget_ms))
+    {
+        return -1;
+    }
+
+    // Exponential ceiling (shift capped well short of overflow)
+    uint64_t ceil_ms = (uint64_t)policy.base_delay_ms << min(attempt - 1, 20u);
+    ceil_ms = min(ceil_ms, (uint64_t)policy.max_delay_ms);
+    ceil_ms = min(ceil_ms, (uint64_t)(policy.budget_ms - waited_ms));
+
+    return (long)(retry_rng() % (ceil_ms + 1));
+}
+
+/**
+ * \brief Query number of Get[] calls answered from cache
+ */
+uint64_t drive::get_cache_hits() const
+{
+    return cache_hits;
+}
+
+/**
+ * \brief Query number of Get[] calls sent to drive with cache enabled
+ */
+uint64_t drive::get_cache_misses() const
+{
+    return cache_misses;
+}
+
+/**
+ * \brief Pick transfer size for binary table I/O
+ *
+ * Largest transfer fitting in a single token, rounded down to
+ * the table's access granularity (when known).
+ *
+ * @param tbl_uid Identifier of target table
+ * @return Bytes per Get[] / Set[]
+ */
+uint64_t drive::bin_xfer_size(uint64_t tbl_uid)
+{
+    uint64_t gran = 0;
+
+    // Not every session may read the Table table, so treat that as a
+    // table with no preference (for this transfer only; the catalog is
+    // left alone, so a later query may still succeed)
+    try
+    {
+        table_desc_t const &desc = get_table_desc(tbl_uid);
+        gran = (desc.write_gran > desc.access_gran ? desc.write_gran : desc.access_gran);
+    }
+    catch (topaz_exception &e)
+    {
+        gran = 0;
+    }
+
+    // Granularity larger than a token can't be honored anyways
+    if ((gran < 2) || (gran > max_token))
+    {
+        return max_token;
+    }
+
+    return max_token / gran * gran;
+}
+
+/**
+ * \brief Drop cached Get[] responses affected by a method call
+ *
+ * @param object_uid UID of object method is invoked on
+ * @param method_uid UID of method being invoked
+ */
+void drive::cache_invalidate(uint64_t object_uid, uint64_t method_uid)
+{
+    // Nothing to do?
+    if (get_cache.empty())
+    {
+        return;
+    }
+
+    if ((method_uid == SET) || (method_uid == GENKEY))
+    {
+        // Only this object is affected, drop all its cells
+        map<cache_key_t, byte_vector>::iterator first, last;
+        first = get_cache.lower_bound(cache_key_t(object_uid, byte_vector()));
+        for (last = first; (last != get_cache.end()) && (last->first.first == object_uid);
+             last++) {}
+        get_cache.erase(first, last);
+    }
+    else if (object_uid != SESSION_MGR)
+    {
+        // Revert, RevertSP, Activate, and friends can change
+        // most anything in the SP, so start over
+        get_cache.clear();
+    }
 }
 
 /**
@@ -670,9 +1484,14 @@ void drive::forget_session()
 {
     // Treat session as terminated
     session_is_auth = 0;
+    session_is_write = 0;
     session_sp = 0;
     tper_session_id = 0;
     host_session_id = 0;
+
+    // Cached responses are only valid within session
+    get_cache.clear();
+    table_catalog.clear();
 }
 
 /**
@@ -793,6 +1612,12 @@ void drive::send(byte_vector const &outbuf, bool session_ids)
     opal_header_t *header;
     size_t sub_size, pkt_size, com_size, tot_size;
 
+    // Late response to an abandoned call would be taken for ours
+    if (comid_stale)
+    {
+        throw topaz_exception("Drive unusable after abandoned call");
+    }
+
     // Sub Packet contains the actual data
     sub_size = outbuf.size();
 
@@ -853,11 +1678,25 @@ void drive::send(byte_vector const &outbuf, bool session_ids)
  * @param inbuf Inbound data buffer
  */
 void drive::recv(byte_vector &inbuf)
+{
+    if (!try_recv(inbuf, now_us() + (uint64_t)call_timeout_ms * 1000))
+    {
+        abandon_call();
+    }
+}
+
+/**
+ * \brief Receive payload from TCG Opal drive, giving up at deadline
+ *
+ * @param inbuf Inbound data buffer
+ * @param deadline_us Monotonic time (microseconds) to stop waiting
+ * @return False if no response before deadline
+ */
+bool drive::try_recv(byte_vector &inbuf, uint64_t deadline_us)
 {
     unsigned char *block, *payload;
     opal_header_t *header;
     size_t count;
-    byte_vector bytes;
 
     // Use managed buffer
     block = &(raw_buffer[0]);
@@ -865,15 +1704,12 @@ void drive::recv(byte_vector &inbuf)
     // Clear it out
     memset(block, 0, raw_buffer.size());
 
-    // Maximum poll attempts before timeout
-    int max_iters = (TIMEOUT_SECS * 1000) / POLL_MS;
-
     // Set up pointers
     header = (opal_header_t*)block;
     payload = block + sizeof(opal_header_t);
 
     // If still processing, drive may respond with "no data yet" ...
-    do
+    while (true)
     {
         // Receive formatted Com Packet
         raw.if_recv(1, com_id, block, raw_buffer.size() / ATA_BLOCK_SIZE);
@@ -883,17 +1719,17 @@ void drive::recv(byte_vector &inbuf)
         {
             throw topaz_exception("Unexpected ComID in drive response");
         }
-        if (be32toh(header->com_hdr.length) == 0)
+        if (be32toh(header->com_hdr.length) != 0)
         {
-            // Response is not yet ready ... wait a bit and try again
-            usleep(POLL_MS * 1000);
+            break;
         }
-    } while ((be32toh(header->com_hdr.length) == 0) && (--max_iters > 0));
 
-    // Check for timeout
-    if (max_iters == 0)
-    {
-        throw topaz_exception("Timeout waiting for response");
+        // Response is not yet ready ... wait a bit and try again
+        if (now_us() >= deadline_us)
+        {
+            return false;
+        }
+        usleep(POLL_MS * 1000);
     }
 
     // Ready the receiver buffer
@@ -902,6 +1738,69 @@ void drive::recv(byte_vector &inbuf)
     // Extract response
     inbuf.resize(count);
     memcpy(&(inbuf[0]), payload, count);
+    return true;
+}
+
+/**
+ * \brief Decode response, which must be a single datum
+ *
+ * @param dst Datum to decode into
+ * @param resp Encoded response, less method status
+ */
+void drive::decode_response(datum &dst, byte_vector const &resp)
+{
+    // Anything between datum and End of Data is malformed framing
+    if (dst.decode_vector(resp) != resp.size())
+    {
+        throw topaz_exception("Invalid method status on return");
+    }
+}
+
+/**
+ * \brief View response, which must be a single datum
+ *
+ * @param resp Encoded response, less method status
+ * @return View of response
+ */
+datum_view drive::view_response(byte_vector const &resp)
+{
+    // Measure it (headers only), as nothing else walks it up front
+    if (datum_view::skip(&(resp[0]), resp.size()) != resp.size())
+    {
+        throw topaz_exception("Invalid method status on return");
+    }
+
+    return datum_view(resp);
+}
+
+/**
+ * \brief Query largest payload fitting in a single ComPacket
+ */
+size_t drive::max_payload() const
+{
+    size_t room = raw_buffer.size() - sizeof(opal_header_t);
+
+    // Packet (and its Sub Packet) may be held to less than ComPacket
+    size_t pkt_hdrs = sizeof(opal_packet_header_t) + sizeof(opal_sub_packet_header_t);
+    if (tper_max_packet < pkt_hdrs)
+    {
+        return 0;
+    }
+    if (tper_max_packet - pkt_hdrs < room)
+    {
+        room = tper_max_packet - pkt_hdrs;
+    }
+
+    // Sub Packet padded to multiple of 4 bytes
+    return room & ~(size_t)3;
+}
+
+/**
+ * \brief Query most method calls drive accepts in a single ComPacket
+ */
+size_t drive::max_methods() const
+{
+    return tper_max_methods;
 }
 
 /**
@@ -1175,14 +2074,17 @@ void drive::probe_level1()
     datum_vector drive_props = invoke(SESSION_MGR, PROPERTIES, tmp)[0].list();
     TOPAZ_DEBUG(2) printf("  Received %u items\n", (unsigned int)drive_props.size());
 
+    // Unless drive says otherwise, a Packet may fill its ComPacket
+    tper_max_packet = max_xfer;
+
     for (size_t i = 0; i < drive_props.size(); i++)
     {
         // Name of property & value
         string name = drive_props[i].name().get_string();
         uint64_t val = drive_props[i].named_value().value().get_uint();
 
-        // Only one we want here is the MaxComPacketSize,
-        // which specifies the maximum I/O packet length
+        // MaxComPacketSize specifies the maximum I/O packet length,
+        // the rest limit what may be packed into it
         if (name == "MaxComPacketSize")
         {
             if (val < max_xfer)
@@ -1200,6 +2102,31 @@ void drive::probe_level1()
             }
             TOPAZ_DEBUG(2) printf("  Max Token Size is %" PRIu64 "\n", val);
         }
+        else if (name == "MaxPacketSize")
+        {
+            if (val < tper_max_packet)
+            {
+                tper_max_packet = val;
+            }
+            TOPAZ_DEBUG(2) printf("  Max Packet Size is %" PRIu64 "\n", val);
+        }
+        else if (name == "MaxMethods")
+        {
+            // Zero would leave no way to send anything at all
+            tper_max_methods = (val ? val : 1);
+            TOPAZ_DEBUG(2) printf("  Max Methods is %" PRIu64 "\n", val);
+        }
+        else if (name == "MaxSubpackets")
+        {
+            // Always send exactly one Sub Packet, so any value works
+            TOPAZ_DEBUG(2) printf("  Max Subpackets is %" PRIu64 "\n", val);
+        }
+    }
+
+    // Packet can never be bigger than our half of the ComPacket
+    if (tper_max_packet > max_xfer - sizeof(opal_com_packet_header_t))
+    {
+        tper_max_packet = max_xfer - sizeof(opal_com_packet_header_t);
     }
 
     // It's possible that the maximum token size may not actually fit
@@ -31,16 +31,56 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <map>
+#include <random>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <topaz/rawdrive.h>
+#include <topaz/call_builder.h>
 #include <topaz/datum.h>
+#include <topaz/datum_view.h>
+#include <topaz/schema.h>
 
 namespace topaz
 {
 
+    // Table descriptor, as found in the Table table (columns in comments)
+    typedef struct
+    {
+        uint64_t uid;         // UID of described table (0)
+        uint64_t kind;        // Object table (1), or Byte table (2) (4)
+        uint64_t rows;        // Row count, or size of byte table (7)
+        uint64_t write_gran;  // MandatoryWriteGranularity (13)
+        uint64_t access_gran; // RecommendedAccessGranularity (14)
+    } table_desc_t;
+
+    // Retry policy for a method status reported by the drive
+    typedef struct
+    {
+        unsigned max_attempts;  // Total tries, including the first (1 = no retry)
+        unsigned base_delay_ms; // Backoff ceiling after first try (doubles each retry)
+        unsigned max_delay_ms;  // Largest backoff ceiling
+        unsigned budget_ms;     // Give up once this much time spent waiting
+        bool replay_writes;     // Also retry anything but Get, Next, Properties, StartSession
+    } retry_policy_t;
+
+    // Retry counters, accumulated over lifetime of drive
+    typedef struct
+    {
+        uint64_t retries;       // Calls sent again after a retryable status
+        uint64_t recovered;     // Calls eventually succeeding after retry
+        uint64_t gave_up;       // Calls still failing with retries exhausted
+        uint64_t skipped;       // Retryable status, but method not safe to replay
+        uint64_t wait_us;       // Time spent in backoff
+    } retry_stats_t;
+
     class drive
     {
 
+        // Sends batches of calls over session
+        friend class transaction;
+
     public:
 
         /**
@@ -97,16 +137,31 @@ namespace topaz
          * \brief Combined I/O to TCG Opal drive
          *
          * @param sp_uid Target Security Provider for session (ADMIN_SP / LOCKING_SP)
+         * @param write Request Read/Write session (false for read-only queries)
          */
-        void login_anon(uint64_t sp_uid);
+        void login_anon(uint64_t sp_uid, bool write = true);
 
         /**
          * \brief Combined I/O to TCG Opal drive
          *
          * @param sp_uid Target Security Provider for session (ADMIN_SP / LOCKING_SP)
          * @param user_uid
+         * @param write Request Read/Write session (false for read-only queries)
          */
-        void login(uint64_t sp_uid, uint64_t auth_uid, std::string pin);
+        void login(uint64_t sp_uid, uint64_t auth_uid, std::string pin,
+                   bool write = true);
+
+        /**
+         * \brief Authenticated login, without throwing on refusal
+         *
+         * @param sp_uid Target Security Provider for session (ADMIN_SP / LOCKING_SP)
+         * @param auth_uid Authority to log in as
+         * @param pin Credentials of authority
+         * @param write Request Read/Write session (false for read-only queries)
+         * @return Status reported by drive (eg - STA_NOT_AUTHORIZED for wrong PIN)
+         */
+        datum::status_t try_login(uint64_t sp_uid, uint64_t auth_uid,
+                                  std::string const &pin, bool write = true);
 
         /**
          * \brief End TPM session
@@ -120,6 +175,13 @@ namespace topaz
          */
         bool get_session_auth() const;
 
+        /**
+         * \brief Query if writable session
+         *
+         * @return True if Read/Write session is active, false otherwise
+         */
+        bool get_session_write() const;
+
         /**
          * \brief Query for session SP
          *
@@ -156,6 +218,45 @@ namespace topaz
          */
         atom table_get(uint64_t tbl_uid, uint64_t tbl_col);
 
+        /**
+         * \brief Query Range of Values from Specified Table
+         *
+         * @param tbl_uid Identifier of target table
+         * @param start_col First column of data to retrieve (table specific)
+         * @param end_col Last column of data to retrieve (table specific)
+         * @return List of named values, one per column present
+         */
+        datum table_get(uint64_t tbl_uid, uint64_t start_col, uint64_t end_col);
+
+        /**
+         * \brief Query Whole Row into Row Structure (see schema.h)
+         *
+         * Named values are loaded in a single pass over the response,
+         * without decoding it into a datum. Binary columns point into
+         * the response, and so are only valid until the next call.
+         *
+         * @param tbl_uid Identifier of target row
+         * @param row Row structure to fill in
+         */
+        template <class ROW>
+        void table_get_row(uint64_t tbl_uid, ROW &row)
+        {
+            // Method Call - UID.Get[Cellblock()]
+            datum_view rc = invoke_view(swg::call(tbl_uid, GET, swg::cellblock()));
+            schema_decode(rc[0], row);
+        }
+
+        /**
+         * \brief Query Rows Present in Object Table
+         *
+         * @param tbl_uid Identifier of target table
+         * @param where Row to start after (0 for beginning of table)
+         * @param count Maximum number of rows to return
+         * @param uids Storage for row UIDs found
+         */
+        void table_next(uint64_t tbl_uid, uint64_t where, uint64_t count,
+                        std::vector<uint64_t> &uids);
+
         /**
          * \brief Get Binary Table
          *
@@ -174,7 +275,16 @@ namespace topaz
          * @param tbl_col Column number of data to retrieve (table specific)
          * @param val Value to set in column
          */
-        void table_set(uint64_t tbl_uid, uint64_t tbl_col, datum val);
+        void table_set(uint64_t tbl_uid, uint64_t tbl_col, datum const &val);
+
+        /**
+         * \brief Set Value in Specified Table (value taken over)
+         *
+         * @param tbl_uid Identifier of target table
+         * @param tbl_col Column number of data to retrieve (table specific)
+         * @param val Value to set in column
+         */
+        void table_set(uint64_t tbl_uid, uint64_t tbl_col, datum &&val);
 
         /**
          * \brief Set Unsigned Value in Specified Table
@@ -192,7 +302,7 @@ namespace topaz
          * @param tbl_col Column number of data to retrieve (table specific)
          * @param val Value to set in column
          */
-        void table_set(uint64_t tbl_uid, uint64_t tbl_col, std::string val);
+        void table_set(uint64_t tbl_uid, uint64_t tbl_col, std::string const &val);
 
         /**
          * \brief Set Binary Table
@@ -215,6 +325,36 @@ namespace topaz
         void table_set_bin_file(uint64_t tbl_uid, uint64_t offset,
                                 char const *filename);
 
+        /**
+         * \brief Pick transfer size for binary table I/O
+         *
+         * Largest transfer fitting in a single token, rounded down to
+         * the table's access granularity (when known).
+         *
+         * @param tbl_uid Identifier of target table
+         * @return Bytes per Get[] / Set[]
+         */
+        uint64_t bin_xfer_size(uint64_t tbl_uid);
+
+        /**
+         * \brief Query Table Descriptor
+         *
+         * Descriptors are read once per session, and kept in a catalog
+         * for any further queries.
+         *
+         * @param tbl_uid Identifier of target table
+         * @return Descriptor of table
+         */
+        table_desc_t const &get_table_desc(uint64_t tbl_uid);
+
+        /**
+         * \brief Load Every Table Descriptor
+         *
+         * Walk the Table table to fill the session catalog in a few
+         * round trips, rather than one per table on first use.
+         */
+        void load_table_catalog();
+
         /**
          * \brief Retrieve default device PIN
          */
@@ -229,7 +369,143 @@ namespace topaz
          * \return Any data returned from method call
          */
         datum invoke(uint64_t object_uid, uint64_t method_uid,
-                     datum params = datum(datum::LIST));
+                     datum const &params = datum(datum::LIST));
+
+        /**
+         * \brief Method invocation (call builder)
+         *
+         * Call is encoded straight into the per-invoke arena, without
+         * building a datum of its parameters.
+         *
+         * \param call Method call, from swg::call()
+         * \return Any data returned from method call
+         */
+        template <class CALL>
+        datum invoke(CALL const &call)
+        {
+            datum rc;
+            decode_response(rc, invoke_raw(call));
+            return rc;
+        }
+
+        /**
+         * \brief Method invocation, without throwing on method failure
+         *
+         * Expected failures (wrong PIN, SP busy, etc) come back as a
+         * status code. Problems talking to the drive still throw.
+         *
+         * \param object_uid UID indicating object to use for invocation
+         * \param method_uid UID indicating method to call on object
+         * \param params List datum with parameters for method call
+         * \return Status reported by method (STA_SUCCESS on success)
+         */
+        datum::status_t try_invoke(uint64_t object_uid, uint64_t method_uid,
+                                   datum const &params = datum(datum::LIST));
+
+        /**
+         * \brief Method invocation, without throwing on method failure
+         *
+         * \param object_uid UID indicating object to use for invocation
+         * \param method_uid UID indicating method to call on object
+         * \param params List datum with parameters for method call
+         * \param rc View of data returned on success (valid until next call)
+         * \return Status reported by method (STA_SUCCESS on success)
+         */
+        datum::status_t try_invoke(uint64_t object_uid, uint64_t method_uid,
+                                   datum const &params, datum_view &rc);
+
+        /**
+         * \brief Method invocation (call builder), without throwing on method failure
+         *
+         * \param call Method call, from swg::call()
+         * \param rc View of data returned on success (valid until next call)
+         * \return Status reported by method (STA_SUCCESS on success)
+         */
+        template <class CALL>
+        datum::status_t try_invoke(CALL const &call, datum_view &rc)
+        {
+            byte_vector const *resp;
+            datum::status_t status;
+
+            status = invoke_status(call.object_uid(), call.method_uid(),
+                                   encode_call(call), resp);
+            rc = (status == datum::STA_SUCCESS ? view_response(*resp) : datum_view());
+            return status;
+        }
+
+        /**
+         * \brief Enable / disable session cache of Get[] responses
+         *
+         * When enabled, responses to Get[] are kept for the remainder of
+         * the session, keyed by object UID and requested cells. Entries
+         * for an object are dropped on any other method invoked on it,
+         * and the whole cache is dropped at end of session.
+         *
+         * @param enable True to enable cache, false to disable (and clear)
+         */
+        void set_get_cache(bool enable);
+
+        /**
+         * \brief Query number of Get[] calls answered from cache
+         */
+        uint64_t get_cache_hits() const;
+
+        /**
+         * \brief Query number of Get[] calls sent to drive with cache enabled
+         */
+        uint64_t get_cache_misses() const;
+
+        /**
+         * \brief Set retry policy for a method status
+         *
+         * Calls failing with the given status are sent again after a
+         * randomized, exponentially growing delay, until the policy's
+         * attempts or time budget run out. Only Get, Next, Properties
+         * and StartSession are sent again by default; anything else
+         * (Set, GenKey, Revert, ...) only if the policy allows
+         * replaying writes. By default, SP_BUSY and
+         * NO_SESSIONS_AVAILABLE are retried, and nothing else.
+         *
+         * @param status Method status to apply policy to
+         * @param policy Retry parameters (max_attempts of 1 disables retry)
+         */
+        void set_retry_policy(datum::status_t status, retry_policy_t const &policy);
+
+        /**
+         * \brief Query retry policy for a method status
+         *
+         * @param status Method status to look up
+         * @return Retry parameters (max_attempts of 1 if not retried)
+         */
+        retry_policy_t get_retry_policy(datum::status_t status) const;
+
+        /**
+         * \brief Query retry counters
+         */
+        retry_stats_t const &get_retry_stats() const;
+
+        /**
+         * \brief Set deadline for each method call
+         *
+         * A call with no response by its deadline (retries included) is
+         * abandoned: the ComID is reset, the session is forgotten, and the
+         * call throws topaz_timeout (try_* calls included, as this is not
+         * a method status). Drives without STACK_RESET cannot drop the
+         * late response, so every later call throws instead.
+         *
+         * @param timeout_ms Milliseconds to wait for each call to complete
+         */
+        void set_call_timeout(unsigned timeout_ms);
+
+        /**
+         * \brief Query deadline for each method call
+         */
+        unsigned get_call_timeout() const;
+
+        /**
+         * \brief Query number of method calls abandoned at deadline
+         */
+        uint64_t get_call_timeouts() const;
 
         /**
          * \brief Invoke Revert[] on Admin_SP, and handle session termination
@@ -272,6 +548,122 @@ namespace topaz
 
     protected:
 
+        /**
+         * \brief Method invocation, response kept in per-invoke arena
+         *
+         * Encoded call, raw response, and decoded response tree all live
+         * in storage owned by the drive, which is reused from one call to
+         * the next rather than freed.
+         *
+         * \param object_uid UID indicating object to use for invocation
+         * \param method_uid UID indicating method to call on object
+         * \param params List datum with parameters for method call
+         * \return Data returned from method call (valid until next call)
+         */
+        datum const &invoke_arena(uint64_t object_uid, uint64_t method_uid,
+                                  datum const &params = datum(datum::LIST));
+
+        /**
+         * \brief Method invocation, response left encoded
+         *
+         * Cheapest way to pick a few fields out of a response, as nothing
+         * is decoded or copied until asked for.
+         *
+         * \param object_uid UID indicating object to use for invocation
+         * \param method_uid UID indicating method to call on object
+         * \param params List datum with parameters for method call
+         * \return View of data returned from method call (valid until next call)
+         */
+        datum_view invoke_view(uint64_t object_uid, uint64_t method_uid,
+                               datum const &params = datum(datum::LIST));
+
+        /**
+         * \brief Method invocation, returning encoded response
+         *
+         * \param object_uid UID indicating object to use for invocation
+         * \param method_uid UID indicating method to call on object
+         * \param params List datum with parameters for method call
+         * \return Encoded response, less method status (valid until next call)
+         */
+        byte_vector const &invoke_raw(uint64_t object_uid, uint64_t method_uid,
+                                      datum const &params = datum(datum::LIST));
+
+        /**
+         * \brief Method invocation (call builder), returning encoded response
+         *
+         * \param call Method call, from swg::call()
+         * \return Encoded response, less method status (valid until next call)
+         */
+        template <class CALL>
+        byte_vector const &invoke_raw(CALL const &call)
+        {
+            return invoke_encoded(call.object_uid(), call.method_uid(), encode_call(call));
+        }
+
+        /**
+         * \brief Encode method call into arena
+         *
+         * \param object_uid UID indicating object to use for invocation
+         * \param method_uid UID indicating method to call on object
+         * \param params List datum with parameters for method call
+         * \return Bytes of encoded call at start of arena
+         */
+        size_t encode_call(uint64_t object_uid, uint64_t method_uid, datum const &params);
+
+        /**
+         * \brief Encode method call (call builder) into arena
+         *
+         * \param call Method call, from swg::call()
+         * \return Bytes of encoded call at start of arena
+         */
+        template <class CALL>
+        size_t encode_call(CALL const &call)
+        {
+            // Room for status list, tacked on later
+            size_t call_size = call.size();
+            arena_bytes.resize(call_size + 6);
+            call.encode_bytes(&(arena_bytes[0]));
+            return call_size;
+        }
+
+        /**
+         * \brief Method invocation (call builder), response left encoded
+         *
+         * \param call Method call, from swg::call()
+         * \return View of data returned from method call (valid until next call)
+         */
+        template <class CALL>
+        datum_view invoke_view(CALL const &call)
+        {
+            return view_response(invoke_raw(call));
+        }
+
+        /**
+         * \brief Method invocation, call already encoded in arena
+         *
+         * \param object_uid UID indicating object to use for invocation
+         * \param method_uid UID indicating method to call on object
+         * \param call_size Bytes of encoded call at start of arena
+         * \return Encoded response, less method status (valid until next call)
+         */
+        byte_vector const &invoke_encoded(uint64_t object_uid, uint64_t method_uid,
+                                          size_t call_size);
+
+        /**
+         * \brief Method invocation, call already encoded in arena
+         *
+         * Only problems talking to the drive (or making sense of what it says)
+         * are thrown; method failure is left to the caller.
+         *
+         * \param object_uid UID indicating object to use for invocation
+         * \param method_uid UID indicating method to call on object
+         * \param call_size Bytes of encoded call at start of arena
+         * \param resp Encoded response on success, less method status (valid until next call)
+         * \return Status reported by method
+         */
+        datum::status_t invoke_status(uint64_t object_uid, uint64_t method_uid,
+                                      size_t call_size, byte_vector const *&resp);
+
         /**
          * \brief Send payload to TCG Opal drive
          *
@@ -287,6 +679,41 @@ namespace topaz
          */
         void recv(byte_vector &inbuf);
 
+        /**
+         * \brief Receive payload from TCG Opal drive, giving up at deadline
+         *
+         * @param inbuf Inbound data buffer
+         * @param deadline_us Monotonic time (microseconds) to stop waiting
+         * @return False if no response before deadline
+         */
+        bool try_recv(byte_vector &inbuf, uint64_t deadline_us);
+
+        /**
+         * \brief Decode response, which must be a single datum
+         *
+         * @param dst Datum to decode into
+         * @param resp Encoded response, less method status
+         */
+        static void decode_response(datum &dst, byte_vector const &resp);
+
+        /**
+         * \brief View response, which must be a single datum
+         *
+         * @param resp Encoded response, less method status
+         * @return View of response
+         */
+        static datum_view view_response(byte_vector const &resp);
+
+        /**
+         * \brief Query largest payload fitting in a single ComPacket
+         */
+        size_t max_payload() const;
+
+        /**
+         * \brief Query most method calls drive accepts in a single ComPacket
+         */
+        size_t max_methods() const;
+
         /**
          * \brief Probe Available TPM Security Protocols
          */
@@ -325,17 +752,87 @@ namespace topaz
          */
         char const *lookup_tpm_proto(uint8_t proto);
 
+        /**
+         * \brief Drop cached Get[] responses affected by a method call
+         *
+         * @param object_uid UID of object method is invoked on
+         * @param method_uid UID of method being invoked
+         */
+        void cache_invalidate(uint64_t object_uid, uint64_t method_uid);
+
+        /**
+         * \brief Abandon method call which missed its deadline (throws)
+         */
+        void abandon_call();
+
+        /**
+         * \brief Check if method may be safely sent again
+         *
+         * @param method_uid UID of method being invoked
+         * @return False for methods which change (or may change) drive state
+         */
+        static bool is_idempotent(uint64_t method_uid);
+
+        /**
+         * \brief Pick backoff before retrying a failed method call
+         *
+         * @param status Status reported by failed call
+         * @param method_uid UID of method being invoked
+         * @param attempt Number of tries made so far
+         * @param waited_ms Time already spent in backoff for this call
+         * @return Delay in milliseconds, or -1 to give up
+         */
+        long retry_delay(unsigned status, uint64_t method_uid, unsigned attempt,
+                         uint64_t waited_ms);
+
+        /**
+         * \brief Add row of Table table to session catalog
+         *
+         * @param tbl_id High UID of described table
+         * @param row Columns of descriptor row
+         * @return Catalog entry
+         */
+        table_desc_t const &add_table_desc(uint64_t tbl_id, datum const &row);
+
         // Underlying Device implementing IF-SEND/RECV
         rawdrive raw;
         byte_vector raw_buffer;
         uint64_t max_token;
+        uint64_t tper_max_packet;
+        uint64_t tper_max_methods;
+
+        // Per-invoke arena (reset, not freed, between calls)
+        byte_vector arena_bytes;
+        datum arena_resp;
 
         // TPM session data
         uint64_t session_sp;
         bool session_is_auth;
+        bool session_is_write;
         uint64_t tper_session_id;
         uint64_t host_session_id;
 
+        // Session cache of encoded Get[] responses (object UID, encoded cells)
+        typedef std::pair<uint64_t, byte_vector> cache_key_t;
+        std::map<cache_key_t, byte_vector> get_cache;
+        bool cache_enabled;
+        uint64_t cache_hits;
+        uint64_t cache_misses;
+
+        // Retry policies (keyed by method status), and counters
+        std::map<unsigned, retry_policy_t> retry_policies;
+        retry_stats_t retry_stats;
+        byte_vector retry_bytes;
+        std::minstd_rand retry_rng;
+
+        // Method call deadline
+        unsigned call_timeout_ms;
+        uint64_t call_timeouts;
+        bool comid_stale;
+
+        // Session catalog of table descriptors (keyed by table UID)
+        std::unordered_map<uint64_t, table_desc_t> table_catalog;
+
         // Internal info describing drive
         swg_msg_type_t msg_type;   // Enterprise or Opal
         bool has_proto_reset;
@@ -67,6 +67,22 @@ byte_vector encodable::encode_vector() const
     return data;
 }
 
+/**
+ * \brief Encode to Existing Container
+ *
+ * Container is resized to fit, reusing any storage it already has.
+ *
+ * @param data Container for encoded data
+ */
+void encodable::encode_vector(byte_vector &data) const
+{
+    // Resize to appropriate size
+    data.resize(size());
+
+    // Set up the data call
+    encode_bytes(&(data[0]));
+}
+
 /**
  * \brief Decode from Container
  *
@@ -67,6 +67,15 @@ namespace topaz
          */
         byte_vector encode_vector() const;
 
+        /**
+         * \brief Encode to Existing Container
+         *
+         * Container is resized to fit, reusing any storage it already has.
+         *
+         * @param data Container for encoded data
+         */
+        void encode_vector(byte_vector &data) const;
+
         /**
          * \brief Decode from data buffer
          *
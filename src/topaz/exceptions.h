@@ -1,3 +1,6 @@
+#ifndef TOPAZ_EXCEPTIONS_H
+#define TOPAZ_EXCEPTIONS_H
+
 /**
  * Topaz - Exceptions
  *
@@ -43,4 +46,16 @@ namespace topaz
 
     };
 
+    class topaz_timeout: public topaz_exception
+    {
+
+      public:
+
+      topaz_timeout(std::string const& msg)
+          : topaz_exception(msg) {}
+
+    };
+
 };
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef TOPAZ_INT_CODEC_H
+#define TOPAZ_INT_CODEC_H
+
+/**
+ * Topaz - Integer Atom Kernels
+ *
+ * Small inline kernels behind integer atoms. Encoding width comes from
+ * a single count of leading zero / sign bits, rather than testing a byte
+ * at a time, and decoding uses a couple of (possibly overlapping)
+ * unaligned big endian loads, never reading outside the atom.
+ *
+ * Copyright (c) 2014, T Parys
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <topaz/defs.h>
+#include <topaz/portable_endian.h>
+
+namespace topaz
+{
+
+    /**
+     * \brief Count leading zero bytes of unsigned integer
+     *
+     * @param val Value to be encoded
+     * @return Bytes that can be dropped (0 - 8)
+     */
+    inline unsigned skip_uint_bytes(uint64_t val)
+    {
+#if defined(__GNUC__)
+        return (val ? __builtin_clzll(val) >> 3 : 8);
+#else
+        unsigned skip = 8;
+        for (; val; val >>= 8)
+        {
+            skip--;
+        }
+        return skip;
+#endif
+    }
+
+    /**
+     * \brief Count leading sign bytes of signed integer
+     *
+     * Only whole bytes of sign bits are dropped, and only while the
+     * remaining value still carries its sign in its top bit.
+     *
+     * @param val Value to be encoded
+     * @return Bytes that can be dropped (0 - 7)
+     */
+    inline unsigned skip_int_bytes(int64_t val)
+    {
+#if defined(__GNUC__)
+        return __builtin_clrsbll(val) >> 3;
+#else
+        // Flip negatives, so both are a count of leading zeroes
+        uint64_t bits = (uint64_t)(val ^ (val >> 63));
+        unsigned skip = 8;
+        for (bits <<= 1; bits; bits >>= 8)
+        {
+            skip--;
+        }
+        return (skip == 8 ? 7 : skip);
+#endif
+    }
+
+    /**
+     * \brief Unaligned load of big endian 16 bit integer
+     */
+    inline uint64_t load_be16(byte const *data)
+    {
+        uint16_t val;
+        memcpy(&val, data, sizeof(val));
+        return be16toh(val);
+    }
+
+    /**
+     * \brief Unaligned load of big endian 32 bit integer
+     */
+    inline uint64_t load_be32(byte const *data)
+    {
+        uint32_t val;
+        memcpy(&val, data, sizeof(val));
+        return be32toh(val);
+    }
+
+    /**
+     * \brief Unaligned load of big endian 64 bit integer
+     */
+    inline uint64_t load_be64(byte const *data)
+    {
+        uint64_t val;
+        memcpy(&val, data, sizeof(val));
+        return be64toh(val);
+    }
+
+    /**
+     * \brief Load big endian unsigned integer
+     *
+     * Widths between load sizes are read as two overlapping loads, so
+     * nothing past the last byte is ever touched.
+     *
+     * @param data Location of integer
+     * @param len  Length of integer (1 - 8 bytes)
+     * @return Value of integer
+     */
+    inline uint64_t load_be_uint(byte const *data, size_t len)
+    {
+        size_t extra;
+
+        if (len >= 8)
+        {
+            return load_be64(data + len - 8);
+        }
+        else if (len >= 4)
+        {
+            // First four bytes, then tail out of last four
+            extra = 8 * (len - 4);
+            return (load_be32(data) << extra) |
+                   (load_be32(data + len - 4) & ((1ULL << extra) - 1));
+        }
+        else if (len >= 2)
+        {
+            // First two bytes, then tail out of last two
+            extra = 8 * (len - 2);
+            return (load_be16(data) << extra) |
+                   (load_be16(data + len - 2) & ((1ULL << extra) - 1));
+        }
+        return (len ? data[0] : 0);
+    }
+
+    /**
+     * \brief Load big endian signed integer (sign extended)
+     *
+     * @param data Location of integer
+     * @param len  Length of integer (1 - 8 bytes)
+     * @return Value of integer
+     */
+    inline int64_t load_be_int(byte const *data, size_t len)
+    {
+        // Top byte into top of word, then arithmetic shift back down
+        size_t shift = (len < 8 ? 64 - 8 * len : 0);
+        if (len == 0)
+        {
+            return 0;
+        }
+        return (int64_t)(load_be_uint(data, len) << shift) >> shift;
+    }
+
+};
+
+#endif
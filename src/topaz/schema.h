@@ -0,0 +1,297 @@
+#ifndef TOPAZ_SCHEMA_H
+#define TOPAZ_SCHEMA_H
+
+/**
+ * Topaz - Table Schemas
+ *
+ * This file maps the columns of well known tables onto plain structures,
+ * so the named values of a Get[] response can be picked up in one pass
+ * over the encoded response, rather than a linear search (and copy) per
+ * column wanted.
+ *
+ * Copyright (c) 2014, T Parys
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <topaz/atom_view.h>
+#include <topaz/datum_view.h>
+#include <topaz/defs.h>
+#include <topaz/exceptions.h>
+
+namespace topaz
+{
+
+    namespace schema
+    {
+
+        //////////////////////////////////////////////////////////////////////////
+        // Column Types
+        //
+
+        // Unsigned integer (uinteger, boolean, enumerations)
+        struct uint_col
+        {
+            typedef uint64_t type;
+            static void load(type &dst, datum_view const &val)
+            {
+                dst = val.get_uint();
+            }
+        };
+
+        // Reference to another object (uidref)
+        struct uid_col
+        {
+            typedef uint64_t type;
+            static void load(type &dst, datum_view const &val)
+            {
+                dst = val.get_uid();
+            }
+        };
+
+        // Binary data (in place, valid as long as the response buffer)
+        struct bytes_col
+        {
+            typedef byte_span_t type;
+            static void load(type &dst, datum_view const &val)
+            {
+                dst = val.value().get_bytes();
+            }
+        };
+
+        // List of reset types, as a bit mask (1 << type)
+        struct resets_col
+        {
+            typedef uint64_t type;
+            static void load(type &dst, datum_view const &val)
+            {
+                datum_view item;
+                size_t pos = 0;
+
+                dst = 0;
+                while (val.next_item(pos, item))
+                {
+                    uint64_t reset = item.get_uint();
+                    if (reset < 64)
+                    {
+                        dst |= (1ULL << reset);
+                    }
+                }
+            }
+        };
+
+        // Reset types found in resets_col
+        enum
+        {
+            POWER_CYCLE   = 0,
+            HARDWARE      = 1,
+            HOTPLUG       = 2,
+            PROGRAMMATIC  = 3
+        };
+
+    };
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Column Layouts - X(column number, column type, member name)
+    //
+
+    // Locking SP - Locking table (LBA ranges)
+#define TOPAZ_LOCKING_RANGE_COLS(X)                                           \
+    X( 0, uid_col,    uid)                                                    \
+    X( 1, bytes_col,  name)                                                   \
+    X( 2, bytes_col,  common_name)                                            \
+    X( 3, uint_col,   range_start)                                            \
+    X( 4, uint_col,   range_length)                                           \
+    X( 5, uint_col,   read_lock_enabled)                                      \
+    X( 6, uint_col,   write_lock_enabled)                                     \
+    X( 7, uint_col,   read_locked)                                            \
+    X( 8, uint_col,   write_locked)                                           \
+    X( 9, resets_col, lock_on_reset)                                          \
+    X(10, uid_col,    active_key)                                             \
+    X(11, uid_col,    next_key)                                               \
+    X(12, uint_col,   reencrypt_state)                                        \
+    X(13, uint_col,   reencrypt_request)                                      \
+    X(14, uint_col,   adv_key_mode)                                           \
+    X(15, uint_col,   verify_mode)                                            \
+    X(16, resets_col, cont_on_reset)                                          \
+    X(17, uint_col,   last_reencrypt_lba)                                     \
+    X(18, uint_col,   last_reenc_stat)
+
+    // Authority table (users & groups)
+#define TOPAZ_AUTHORITY_COLS(X)                                               \
+    X( 0, uid_col,    uid)                                                    \
+    X( 1, bytes_col,  name)                                                   \
+    X( 2, bytes_col,  common_name)                                            \
+    X( 3, uint_col,   is_class)                                               \
+    X( 4, uid_col,    class_uid)                                              \
+    X( 5, uint_col,   enabled)                                                \
+    X( 6, uint_col,   secure)                                                 \
+    X( 7, uint_col,   hash_and_sign)                                          \
+    X( 8, uint_col,   present_certificate)                                    \
+    X( 9, uint_col,   operation)                                              \
+    X(10, uid_col,    credential)                                             \
+    X(11, uid_col,    response_sign)                                          \
+    X(12, uid_col,    response_exch)                                          \
+    X(15, uint_col,   limit)                                                  \
+    X(16, uint_col,   uses)                                                   \
+    X(17, uint_col,   log)                                                    \
+    X(18, uid_col,    log_to)
+
+    // C_PIN table (PINs of Authorities)
+#define TOPAZ_C_PIN_COLS(X)                                                   \
+    X( 0, uid_col,    uid)                                                    \
+    X( 1, bytes_col,  name)                                                   \
+    X( 2, bytes_col,  common_name)                                            \
+    X( 3, bytes_col,  pin)                                                    \
+    X( 4, uid_col,    char_set)                                               \
+    X( 5, uint_col,   try_limit)                                              \
+    X( 6, uint_col,   tries)                                                  \
+    X( 7, uint_col,   persistence)
+
+    // Locking SP - LockingInfo table
+#define TOPAZ_LOCKING_INFO_COLS(X)                                            \
+    X( 0, uid_col,    uid)                                                    \
+    X( 1, bytes_col,  name)                                                   \
+    X( 2, uint_col,   version)                                                \
+    X( 3, uint_col,   encrypt_support)                                        \
+    X( 4, uint_col,   max_ranges)                                             \
+    X( 5, uint_col,   max_reencryptions)                                      \
+    X( 6, uint_col,   keys_available_cfg)                                     \
+    X( 7, uint_col,   alignment_required)                                     \
+    X( 8, uint_col,   logical_block_size)                                     \
+    X( 9, uint_col,   alignment_granularity)                                  \
+    X(10, uint_col,   lowest_aligned_lba)
+
+    // Locking SP - MBRControl table
+#define TOPAZ_MBR_CONTROL_COLS(X)                                             \
+    X( 0, uid_col,    uid)                                                    \
+    X( 1, uint_col,   enable)                                                 \
+    X( 2, uint_col,   done)                                                   \
+    X( 3, resets_col, done_on_reset)
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Row Structures
+    //
+    // Each gets a member per column, plus a mask of columns present in the
+    // response (bit N set for column N), and a schema_column() overload
+    // which loads one named value into place.
+    //
+
+#define TOPAZ_SCHEMA_MEMBER(col, kind, member)                                \
+    static_assert(col < 64, "Schema column out of range of presence mask");   \
+    schema::kind::type member;
+#define TOPAZ_SCHEMA_CASE(col, kind, member)                                  \
+    case col:                                                                 \
+        schema::kind::load(row.member, val);                                  \
+        break;
+#define TOPAZ_SCHEMA_ROW(row_t, COLS)                                         \
+    typedef struct                                                            \
+    {                                                                         \
+        COLS(TOPAZ_SCHEMA_MEMBER)                                             \
+        uint64_t present;                                                     \
+    } row_t;                                                                  \
+                                                                              \
+    inline bool schema_column(row_t &row, uint64_t col, datum_view const &val) \
+    {                                                                         \
+        switch (col)                                                          \
+        {                                                                     \
+            COLS(TOPAZ_SCHEMA_CASE)                                           \
+            default:                                                          \
+                return false;                                                 \
+        }                                                                     \
+        row.present |= (1ULL << col);                                         \
+        return true;                                                          \
+    }
+
+    TOPAZ_SCHEMA_ROW(locking_range_t, TOPAZ_LOCKING_RANGE_COLS)
+    TOPAZ_SCHEMA_ROW(authority_t,     TOPAZ_AUTHORITY_COLS)
+    TOPAZ_SCHEMA_ROW(c_pin_t,         TOPAZ_C_PIN_COLS)
+    TOPAZ_SCHEMA_ROW(locking_info_t,  TOPAZ_LOCKING_INFO_COLS)
+    TOPAZ_SCHEMA_ROW(mbr_control_t,   TOPAZ_MBR_CONTROL_COLS)
+
+#undef TOPAZ_SCHEMA_ROW
+#undef TOPAZ_SCHEMA_CASE
+#undef TOPAZ_SCHEMA_MEMBER
+
+    /**
+     * \brief Load named values of a Get[] response into row structure
+     *
+     * Columns not part of the row structure are skipped, and a column of
+     * the wrong type throws, as any other misread of the response would.
+     *
+     * @param cols List of named values, one per column present
+     * @param row Row structure to fill in (zeroed first)
+     */
+    template <class ROW>
+    void schema_decode(datum_view const &cols, ROW &row)
+    {
+        atom_view name;
+        datum_view value;
+        size_t pos = 0;
+
+        row = ROW();
+        while (cols.next_named(pos, name, value))
+        {
+            if (name.get_type() == atom::UINT)
+            {
+                schema_column(row, name.get_uint(), value);
+            }
+        }
+    }
+
+    /**
+     * \brief Query if column was present in response
+     *
+     * @param row Row structure, from schema_decode()
+     * @param col Column number
+     */
+    template <class ROW>
+    bool schema_has(ROW const &row, uint64_t col)
+    {
+        return (col < 64) && (row.present & (1ULL << col));
+    }
+
+    /**
+     * \brief Require columns to be present in response
+     *
+     * Absent columns are left zeroed by schema_decode(), which is not
+     * to be mistaken for data, so throw as a missing named value would.
+     *
+     * @param row Row structure, from schema_decode()
+     * @param cols Column numbers
+     * @param count Number of columns
+     */
+    template <class ROW>
+    void schema_require(ROW const &row, uint64_t const *cols, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if (!schema_has(row, cols[i]))
+            {
+                throw topaz_exception("Named value not found in list");
+            }
+        }
+    }
+
+};
+
+#endif
@@ -0,0 +1,177 @@
+/**
+ * Topaz - Table Iterator
+ *
+ * This class walks the rows actually present in an object table, using
+ * Next[] to list row UIDs a page at a time. Requested columns of each row
+ * are read as each page is listed, ahead of the caller consuming them.
+ *
+ * Copyright (c) 2014, T Parys
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <topaz/drive.h>
+#include <topaz/exceptions.h>
+#include <topaz/table_iter.h>
+using namespace topaz;
+
+/**
+ * \brief Row UID Iterator Constructor
+ *
+ * @param target Drive with open session
+ * @param tbl_uid Identifier of target table
+ * @param get_rows Also read whole row of each UID
+ */
+table_iter::table_iter(drive &target, uint64_t tbl_uid, bool get_rows)
+    : target(target), tbl_uid(tbl_uid), page_size(TABLE_ITER_PAGE),
+      get_rows(get_rows), get_cols(false), start_col(0), end_col(0),
+      idx(0), last_page(false)
+{
+    // Nada
+}
+
+/**
+ * \brief Row Column Iterator Constructor
+ *
+ * @param target Drive with open session
+ * @param tbl_uid Identifier of target table
+ * @param start_col First column to read of each row
+ * @param end_col Last column to read of each row
+ */
+table_iter::table_iter(drive &target, uint64_t tbl_uid, uint64_t start_col,
+                       uint64_t end_col)
+    : target(target), tbl_uid(tbl_uid), page_size(TABLE_ITER_PAGE),
+      get_rows(false), get_cols(true), start_col(start_col), end_col(end_col),
+      idx(0), last_page(false)
+{
+    // Nada
+}
+
+/**
+ * \brief Destructor
+ */
+table_iter::~table_iter()
+{
+    // Nada
+}
+
+/**
+ * \brief Change number of rows listed per Next[]
+ *
+ * @param page_size Number of rows to list per Next[]
+ */
+void table_iter::set_page_size(size_t page_size)
+{
+    this->page_size = (page_size ? page_size : 1);
+}
+
+/**
+ * \brief Advance to next row
+ *
+ * @return False once all rows have been visited
+ */
+bool table_iter::next()
+{
+    // Still working through current page?
+    if (idx + 1 < page_uids.size())
+    {
+        idx++;
+        return true;
+    }
+
+    // Nothing left to list
+    if (last_page)
+    {
+        page_uids.clear();
+        page_rows.clear();
+        return false;
+    }
+
+    // Next batch
+    fetch_page();
+    return !page_uids.empty();
+}
+
+/**
+ * \brief Query UID of current row
+ */
+uint64_t table_iter::get_uid() const
+{
+    if (idx >= page_uids.size())
+    {
+        throw topaz_exception("No current row in table iterator");
+    }
+
+    return page_uids[idx];
+}
+
+/**
+ * \brief Query columns of current row
+ *
+ * @return List of named values, one per column present
+ */
+datum const &table_iter::get_row() const
+{
+    if (idx >= page_rows.size())
+    {
+        throw topaz_exception("No row data in table iterator");
+    }
+
+    return page_rows[idx];
+}
+
+/**
+ * \brief List next page of rows (and their columns, if requested)
+ */
+void table_iter::fetch_page()
+{
+    // Pick up after the last row of the previous page
+    uint64_t where = (page_uids.empty() ? 0 : page_uids.back());
+
+    // Table.Next[]
+    target.table_next(tbl_uid, where, page_size, page_uids);
+    idx = 0;
+
+    // Short page means we've hit the end of the table
+    if (page_uids.size() < page_size)
+    {
+        last_page = true;
+    }
+
+    // Read the whole page worth of rows while we're at it
+    page_rows.clear();
+    if (get_rows || get_cols)
+    {
+        page_rows.resize(page_uids.size());
+        for (size_t i = 0; i < page_uids.size(); i++)
+        {
+            if (get_cols)
+            {
+                page_rows[i] = target.table_get(page_uids[i], start_col, end_col);
+            }
+            else
+            {
+                page_rows[i] = target.table_get(page_uids[i]);
+            }
+        }
+    }
+}
@@ -0,0 +1,130 @@
+#ifndef TOPAZ_TABLE_ITER_H
+#define TOPAZ_TABLE_ITER_H
+
+/**
+ * Topaz - Table Iterator
+ *
+ * This class walks the rows actually present in an object table, using
+ * Next[] to list row UIDs a page at a time. Requested columns of each row
+ * are read as each page is listed, ahead of the caller consuming them.
+ *
+ * Copyright (c) 2014, T Parys
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <vector>
+#include <topaz/datum.h>
+
+// Default number of rows to list per Next[]
+#define TABLE_ITER_PAGE 64
+
+namespace topaz
+{
+
+    class drive;
+
+    class table_iter
+    {
+
+      public:
+
+        /**
+         * \brief Row UID Iterator Constructor
+         *
+         * @param target Drive with open session
+         * @param tbl_uid Identifier of target table
+         * @param get_rows Also read whole row of each UID
+         */
+        table_iter(drive &target, uint64_t tbl_uid, bool get_rows = false);
+
+        /**
+         * \brief Row Column Iterator Constructor
+         *
+         * @param target Drive with open session
+         * @param tbl_uid Identifier of target table
+         * @param start_col First column to read of each row
+         * @param end_col Last column to read of each row
+         */
+        table_iter(drive &target, uint64_t tbl_uid, uint64_t start_col,
+                   uint64_t end_col);
+
+        /**
+         * \brief Destructor
+         */
+        ~table_iter();
+
+        /**
+         * \brief Change number of rows listed per Next[]
+         *
+         * @param page_size Number of rows to list per Next[]
+         */
+        void set_page_size(size_t page_size);
+
+        /**
+         * \brief Advance to next row
+         *
+         * @return False once all rows have been visited
+         */
+        bool next();
+
+        /**
+         * \brief Query UID of current row
+         */
+        uint64_t get_uid() const;
+
+        /**
+         * \brief Query columns of current row
+         *
+         * @return List of named values, one per column present
+         */
+        datum const &get_row() const;
+
+      protected:
+
+        /**
+         * \brief List next page of rows (and their columns, if requested)
+         */
+        void fetch_page();
+
+        // Where to look
+        drive &target;
+        uint64_t tbl_uid;
+        size_t page_size;
+
+        // What to read of each row
+        bool get_rows;
+        bool get_cols;
+        uint64_t start_col;
+        uint64_t end_col;
+
+        // Current page
+        std::vector<uint64_t> page_uids;
+        datum_vector page_rows;
+        size_t idx;
+        bool last_page;
+
+    };
+
+};
+
+#endif
@@ -0,0 +1,267 @@
+/**
+ * Topaz - Token Parser
+ *
+ * This class walks a TCG Opal SWG data stream one token at a time, calling
+ * back into a handler for each (start/end of list or name, method call,
+ * atoms, end of data and its status list, and so on). No tree is built and
+ * nothing is allocated, so specialised decoders can pick out just what they
+ * need, and full decoders (see datum_builder) can be layered on top.
+ *
+ * Copyright (c) 2014, T Parys
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <topaz/datum.h>
+#include <topaz/exceptions.h>
+#include <topaz/token_parser.h>
+using namespace topaz;
+
+/**
+ * \brief Destructor
+ */
+token_handler::~token_handler()
+{
+    // Nada
+}
+
+/**
+ * \brief Start of List Token
+ */
+void token_handler::start_list()
+{
+    // Ignored unless overridden
+}
+
+/**
+ * \brief End of List Token
+ */
+void token_handler::end_list()
+{
+    // Ignored unless overridden
+}
+
+/**
+ * \brief Start of Name Token
+ */
+void token_handler::start_name()
+{
+    // Ignored unless overridden
+}
+
+/**
+ * \brief End of Name Token
+ */
+void token_handler::end_name()
+{
+    // Ignored unless overridden
+}
+
+/**
+ * \brief Method Call Token
+ */
+void token_handler::call()
+{
+    // Ignored unless overridden
+}
+
+/**
+ * \brief End of Data Token
+ */
+void token_handler::end_of_data()
+{
+    // Ignored unless overridden
+}
+
+/**
+ * \brief Method Status List (following End of Data)
+ *
+ * @param status Status code reported by method
+ */
+void token_handler::status(unsigned status)
+{
+    // Ignored unless overridden
+}
+
+/**
+ * \brief End of Session Token
+ */
+void token_handler::end_session()
+{
+    // Ignored unless overridden
+}
+
+/**
+ * \brief Start of Transaction Token
+ *
+ * @param code Transaction code
+ */
+void token_handler::start_transaction(unsigned code)
+{
+    // Ignored unless overridden
+}
+
+/**
+ * \brief End of Transaction Token
+ *
+ * @param code Transaction code
+ */
+void token_handler::end_transaction(unsigned code)
+{
+    // Ignored unless overridden
+}
+
+/**
+ * \brief Atom (in place)
+ *
+ * @param val View of encoded atom
+ */
+void token_handler::atom_token(atom_view const &val)
+{
+    // Ignored unless overridden
+}
+
+/**
+ * \brief Query if handler wants to stop parsing
+ *
+ * @return True to stop after current token
+ */
+bool token_handler::done() const
+{
+    // Run to end of buffer
+    return false;
+}
+
+/**
+ * \brief Walk data stream, calling handler for each token
+ *
+ * @param data Location of encoded tokens
+ * @param len  Length of buffer
+ * @param handler Callbacks for each token found
+ * @return Number of bytes processed
+ */
+size_t token_parser::parse(byte const *data, size_t len, token_handler &handler)
+{
+    size_t size = 0;
+
+    while ((size < len) && (!handler.done()))
+    {
+        // Atoms are the bulk of any stream, so check those first
+        if ((data[size] < 0xe4) || (data[size] == atom::EMPTY_TOK))
+        {
+            atom_view val(data + size, len - size);
+            size += val.size();
+            handler.atom_token(val);
+            continue;
+        }
+
+        // Else, some sort of control token
+        byte tok = data[size++];
+        switch (tok)
+        {
+            case datum::TOK_START_LIST:
+                handler.start_list();
+                break;
+
+            case datum::TOK_END_LIST:
+                handler.end_list();
+                break;
+
+            case datum::TOK_START_NAME:
+                handler.start_name();
+                break;
+
+            case datum::TOK_END_NAME:
+                handler.end_name();
+                break;
+
+            case datum::TOK_CALL:
+                handler.call();
+                break;
+
+            case datum::TOK_END_OF_DATA:
+                handler.end_of_data();
+
+                // Status list follows - [ status, 0, 0 ]
+                if ((size < len) && (data[size] == datum::TOK_START_LIST))
+                {
+                    atom_view code, skip;
+                    size_t pos = size + 1;
+
+                    code = atom_view(data + pos, len - pos);
+                    pos += code.size();
+                    for (int i = 0; i < 2; i++)
+                    {
+                        skip = atom_view(data + pos, len - pos);
+                        pos += skip.size();
+                    }
+                    if ((pos >= len) || (data[pos] != datum::TOK_END_LIST))
+                    {
+                        throw topaz_exception("Invalid method status list");
+                    }
+                    size = pos + 1;
+
+                    handler.status((unsigned)code.get_uint());
+                }
+                break;
+
+            case datum::TOK_END_SESSION:
+                handler.end_session();
+                break;
+
+            case datum::TOK_START_TRANS:
+            case datum::TOK_END_TRANS:
+            {
+                // Transaction code follows
+                atom_view code(data + size, len - size);
+                size += code.size();
+                if (tok == datum::TOK_START_TRANS)
+                {
+                    handler.start_transaction((unsigned)code.get_uint());
+                }
+                else
+                {
+                    handler.end_transaction((unsigned)code.get_uint());
+                }
+                break;
+            }
+
+            default:
+                throw topaz_exception("Unexpected token in data stream");
+                break;
+        }
+    }
+
+    return size;
+}
+
+/**
+ * \brief Walk data stream, calling handler for each token
+ *
+ * @param data Buffer of encoded tokens
+ * @param handler Callbacks for each token found
+ * @return Number of bytes processed
+ */
+size_t token_parser::parse(byte_vector const &data, token_handler &handler)
+{
+    return parse((data.empty() ? NULL : &(data[0])), data.size(), handler);
+}
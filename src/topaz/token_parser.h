@@ -0,0 +1,153 @@
+#ifndef TOPAZ_TOKEN_PARSER_H
+#define TOPAZ_TOKEN_PARSER_H
+
+/**
+ * Topaz - Token Parser
+ *
+ * This class walks a TCG Opal SWG data stream one token at a time, calling
+ * back into a handler for each (start/end of list or name, method call,
+ * atoms, end of data and its status list, and so on). No tree is built and
+ * nothing is allocated, so specialised decoders can pick out just what they
+ * need, and full decoders (see datum_builder) can be layered on top.
+ *
+ * Copyright (c) 2014, T Parys
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <topaz/atom_view.h>
+#include <topaz/defs.h>
+
+namespace topaz
+{
+
+    class token_handler
+    {
+
+      public:
+
+        /**
+         * \brief Destructor
+         */
+        virtual ~token_handler();
+
+        /**
+         * \brief Start of List Token
+         */
+        virtual void start_list();
+
+        /**
+         * \brief End of List Token
+         */
+        virtual void end_list();
+
+        /**
+         * \brief Start of Name Token
+         */
+        virtual void start_name();
+
+        /**
+         * \brief End of Name Token
+         */
+        virtual void end_name();
+
+        /**
+         * \brief Method Call Token
+         */
+        virtual void call();
+
+        /**
+         * \brief End of Data Token
+         */
+        virtual void end_of_data();
+
+        /**
+         * \brief Method Status List (following End of Data)
+         *
+         * @param status Status code reported by method
+         */
+        virtual void status(unsigned status);
+
+        /**
+         * \brief End of Session Token
+         */
+        virtual void end_session();
+
+        /**
+         * \brief Start of Transaction Token
+         *
+         * @param code Transaction code
+         */
+        virtual void start_transaction(unsigned code);
+
+        /**
+         * \brief End of Transaction Token
+         *
+         * @param code Transaction code
+         */
+        virtual void end_transaction(unsigned code);
+
+        /**
+         * \brief Atom (in place)
+         *
+         * @param val View of encoded atom
+         */
+        virtual void atom_token(atom_view const &val);
+
+        /**
+         * \brief Query if handler wants to stop parsing
+         *
+         * @return True to stop after current token
+         */
+        virtual bool done() const;
+
+    };
+
+    class token_parser
+    {
+
+      public:
+
+        /**
+         * \brief Walk data stream, calling handler for each token
+         *
+         * @param data Location of encoded tokens
+         * @param len  Length of buffer
+         * @param handler Callbacks for each token found
+         * @return Number of bytes processed
+         */
+        static size_t parse(byte const *data, size_t len, token_handler &handler);
+
+        /**
+         * \brief Walk data stream, calling handler for each token
+         *
+         * @param data Buffer of encoded tokens
+         * @param handler Callbacks for each token found
+         * @return Number of bytes processed
+         */
+        static size_t parse(byte_vector const &data, token_handler &handler);
+
+    };
+
+};
+
+#endif
@@ -0,0 +1,535 @@
+/**
+ * Topaz - Transaction
+ *
+ * This class gathers method calls (Set[], GenKey[], ...) to be applied
+ * atomically, and sends them between Start / End Transaction
+ * tokens, packing as many calls per ComPacket as the drive accepts.
+ *
+ * Copyright (c) 2014, T Parys
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <topaz/call_builder.h>
+#include <topaz/datum_view.h>
+#include <topaz/debug.h>
+#include <topaz/drive.h>
+#include <topaz/exceptions.h>
+#include <topaz/transaction.h>
+#include <topaz/uid.h>
+using namespace std;
+using namespace topaz;
+
+// Bytes of End of Data and method status list following each call
+#define STATUS_SIZE 6
+
+// Bytes of Start / End Transaction token and its status
+#define TRANS_SIZE 2
+
+/**
+ * \brief Constructor
+ *
+ * @param target Drive with open session
+ */
+transaction::transaction(drive &target)
+    : target(target), started(false), done(false)
+{
+    // Nada
+}
+
+/**
+ * \brief Destructor (aborts uncommitted transaction)
+ */
+transaction::~transaction()
+{
+    // Nothing reaches the drive before commit(), so nothing to undo there
+    if (!done)
+    {
+        abort();
+    }
+}
+
+/**
+ * \brief Add method call to transaction
+ *
+ * @param object_uid UID indicating object to use for invocation
+ * @param method_uid UID indicating method to call on object
+ * @param params List datum with parameters for method call
+ */
+void transaction::add(uint64_t object_uid, uint64_t method_uid, datum const &params)
+{
+    size_t at, count;
+
+    // Parameters must be a list (or nothing at all)
+    if (params.get_type() == datum::LIST)
+    {
+        at = start_call(19 + params.size());
+    }
+    else if (params.get_type() == datum::UNSET)
+    {
+        at = start_call(19 + 2);
+    }
+    else
+    {
+        throw topaz_exception("Method parameters must be a list");
+    }
+
+    // Same layout as single method call
+    count = at;
+    calls[count++] = datum::TOK_CALL;
+    memcpy(&(calls[count]), uid_token(object_uid).bytes, sizeof(uid_token_t));
+    count += sizeof(uid_token_t);
+    memcpy(&(calls[count]), uid_token(method_uid).bytes, sizeof(uid_token_t));
+    count += sizeof(uid_token_t);
+    if (params.get_type() == datum::LIST)
+    {
+        count += params.encode_bytes(&(calls[count]));
+    }
+    else
+    {
+        calls[count++] = datum::TOK_START_LIST;
+        calls[count++] = datum::TOK_END_LIST;
+    }
+
+    end_call(object_uid, method_uid, count);
+}
+
+/**
+ * \brief Add Set[] of unsigned value to transaction
+ *
+ * @param tbl_uid Identifier of target table
+ * @param tbl_col Column number of data to set (table specific)
+ * @param val Value to set in column
+ */
+void transaction::set(uint64_t tbl_uid, uint64_t tbl_col, uint64_t val)
+{
+    // Method Call - UID.Set[Values = [column = val]]
+    add(swg::call(tbl_uid, SET,
+                  swg::values(swg::list(swg::column(tbl_col, swg::uint(val))))));
+}
+
+/**
+ * \brief Add Set[] of string value to transaction
+ *
+ * @param tbl_uid Identifier of target table
+ * @param tbl_col Column number of data to set (table specific)
+ * @param val Value to set in column
+ */
+void transaction::set(uint64_t tbl_uid, uint64_t tbl_col, string const &val)
+{
+    // Method Call - UID.Set[Values = [column = val]]
+    byte const *ptr = (byte const*)(val.c_str());
+    add(swg::call(tbl_uid, SET,
+                  swg::values(swg::list(swg::column(tbl_col, swg::bin(ptr, val.size()))))));
+}
+
+/**
+ * \brief Add Set[] of arbitrary value to transaction
+ *
+ * @param tbl_uid Identifier of target table
+ * @param tbl_col Column number of data to set (table specific)
+ * @param val Value to set in column
+ */
+void transaction::set(uint64_t tbl_uid, uint64_t tbl_col, datum const &val)
+{
+    // Parameters - Required Arguments (Simple Atoms)
+    datum params;
+    params[0].name()                         = atom::new_uint(1);       // Values
+    params[0].named_value()[0].name()        = atom::new_uint(tbl_col);
+    params[0].named_value()[0].named_value() = val;
+
+    add(tbl_uid, SET, params);
+}
+
+/**
+ * \brief Add GenKey[] to transaction
+ *
+ * @param key_uid Identifier of key object to regenerate
+ */
+void transaction::genkey(uint64_t key_uid)
+{
+    add(swg::call(key_uid, GENKEY));
+}
+
+/**
+ * \brief Send all calls to drive, and end transaction
+ *
+ * @return STA_SUCCESS, or status of first failing call
+ */
+datum::status_t transaction::commit()
+{
+    size_t room = target.max_payload(), first = 0, count = call_ends.size();
+    datum::status_t status = datum::STA_SUCCESS;
+
+    if (done)
+    {
+        throw topaz_exception("Transaction already finished");
+    }
+    done = true;
+    statuses.assign(count, datum::STA_TRANSACTION_FAILURE);
+
+    // Nothing to do
+    if (count == 0)
+    {
+        return datum::STA_SUCCESS;
+    }
+
+    // Anything set here may change what Get[] would return
+    for (size_t i = 0; i < count; i++)
+    {
+        target.cache_invalidate(call_uids[i].first, call_uids[i].second);
+    }
+
+    // Each call must fit a ComPacket (alongside Start Transaction, in
+    // case it leads), checked before anything is sent
+    room = (room > TRANS_SIZE ? room - TRANS_SIZE : 0);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (pack(call_ends, i, room, 1) == i)
+        {
+            throw topaz_exception("Method call too large for ComPkt");
+        }
+    }
+
+    try
+    {
+        // Start Transaction, then as many calls per ComPacket as the
+        // drive allows, stopping at the first failure
+        while ((first < count) && (status == datum::STA_SUCCESS))
+        {
+            size_t last = pack(call_ends, first, room, target.max_methods());
+            status = exchange(first, last, (first == 0));
+            first = last;
+        }
+
+        // Commit only once every call is known to have succeeded
+        if (!started)
+        {
+            // Drive never started transaction, so nothing to end
+        }
+        else if (status != datum::STA_SUCCESS)
+        {
+            send_abort();
+        }
+        else
+        {
+            started = false;
+            if (send_trans(datum::TOK_END_TRANS, 0) != 0)
+            {
+                status = datum::STA_TRANSACTION_FAILURE;
+            }
+        }
+    }
+    catch (...)
+    {
+        // Don't leave transaction open on drive (if session survived)
+        if (started && target.tper_session_id)
+        {
+            try
+            {
+                send_abort();
+            }
+            catch (topaz_exception &e)
+            {
+                // Report original problem, not this one
+            }
+        }
+        started = false;
+        throw;
+    }
+
+    return status;
+}
+
+/**
+ * \brief Drop all calls, without applying any of them
+ */
+void transaction::abort()
+{
+    calls.clear();
+    call_ends.clear();
+    call_uids.clear();
+    done = true;
+}
+
+/**
+ * \brief Query number of calls in transaction
+ */
+size_t transaction::size() const
+{
+    return call_ends.size();
+}
+
+/**
+ * \brief Query status of call, after commit()
+ *
+ * @param idx Call number, in order added
+ * @return Status reported by call (STA_TRANSACTION_FAILURE if never run)
+ */
+datum::status_t transaction::get_status(size_t idx) const
+{
+    if (idx >= statuses.size())
+    {
+        throw topaz_exception("No status for transaction call");
+    }
+
+    return statuses[idx];
+}
+
+/**
+ * \brief Make room for encoded call
+ *
+ * @param call_size Bytes of encoded call
+ * @return Offset to encode call at
+ */
+size_t transaction::start_call(size_t call_size)
+{
+    if (done)
+    {
+        throw topaz_exception("Transaction already finished");
+    }
+
+    size_t at = calls.size();
+    calls.resize(at + call_size + STATUS_SIZE);
+    return at;
+}
+
+/**
+ * \brief Finish call (End of Data, and status list) after encoding
+ *
+ * @param object_uid UID indicating object to use for invocation
+ * @param method_uid UID indicating method to call on object
+ * @param end Offset just past encoded call
+ */
+void transaction::end_call(uint64_t object_uid, uint64_t method_uid, size_t end)
+{
+    calls[end++] = datum::TOK_END_OF_DATA;
+    calls[end++] = datum::TOK_START_LIST;
+    calls[end++] = 0; // Execute
+    calls[end++] = 0; // Reserved
+    calls[end++] = 0; // Reserved
+    calls[end++] = datum::TOK_END_LIST;
+
+    calls.resize(end);
+    call_ends.push_back(end);
+    call_uids.push_back(make_pair(object_uid, method_uid));
+}
+
+/**
+ * \brief Send one ComPacket worth of calls, and collect statuses
+ *
+ * @param first First call to send
+ * @param last One past last call to send
+ * @param start Lead with Start Transaction
+ * @return STA_SUCCESS, or status of first failing call
+ */
+datum::status_t transaction::exchange(size_t first, size_t last, bool start)
+{
+    size_t begin = (first ? call_ends[first - 1] : 0), offset = 0, idx;
+    unsigned trans_status = 0;
+
+    // Debug
+    TOPAZ_DEBUG(3)
+    {
+        printf("SWG Transaction : %s%zu calls\n", (start ? "Start, " : ""), last - first);
+    }
+
+    // One round trip for the lot
+    resp.clear();
+    if (start)
+    {
+        resp.push_back(datum::TOK_START_TRANS);
+        resp.push_back(0);
+    }
+    resp.insert(resp.end(), calls.begin() + begin, calls.begin() + call_ends[last - 1]);
+    target.send(resp, true);
+    started = (started || start); // Until drive says otherwise
+    target.recv(resp);
+
+    // Start Transaction status
+    if (start)
+    {
+        trans_status = decode_trans_status(resp, datum::TOK_START_TRANS);
+        started = (trans_status == 0);
+        offset = TRANS_SIZE;
+    }
+
+    // Drive may stop short after a failure (rest never ran). If the
+    // transaction was refused, whatever did run is still reported.
+    size_t answered = decode_statuses(resp, offset, last - first, &(statuses[first]));
+    if (trans_status)
+    {
+        return datum::STA_TRANSACTION_FAILURE;
+    }
+    for (idx = first; idx < first + answered; idx++)
+    {
+        if (statuses[idx] != datum::STA_SUCCESS)
+        {
+            // Debug
+            TOPAZ_DEBUG(3)
+            {
+                printf("SWG Transaction : call %zu <STATUS=%u>\n", idx, statuses[idx]);
+            }
+            return statuses[idx];
+        }
+    }
+    if (answered < last - first)
+    {
+        return datum::STA_TRANSACTION_FAILURE;
+    }
+
+    return datum::STA_SUCCESS;
+}
+
+/**
+ * \brief Send Start / End Transaction token on its own
+ *
+ * @param token TOK_START_TRANS or TOK_END_TRANS
+ * @param code Status to send with token (End Transaction: 0 commit, 1 abort)
+ * @return Status returned with token (0 on success)
+ */
+unsigned transaction::send_trans(topaz::byte token, topaz::byte code)
+{
+    // Debug
+    TOPAZ_DEBUG(3)
+    {
+        printf("SWG Transaction : %s %u\n",
+               (token == datum::TOK_START_TRANS ? "Start" : "End"), code);
+    }
+
+    resp.clear();
+    resp.push_back(token);
+    resp.push_back(code);
+    target.send(resp, true);
+    target.recv(resp);
+
+    return decode_trans_status(resp, token);
+}
+
+/**
+ * \brief Abort transaction already started on drive
+ */
+void transaction::send_abort()
+{
+    // End Transaction (1 -> abort), status of no further interest
+    started = false;
+    send_trans(datum::TOK_END_TRANS, 1);
+}
+
+/**
+ * \brief Count calls fitting in one ComPacket
+ *
+ * @param call_ends Offset just past each encoded call
+ * @param first First call to send
+ * @param room Payload bytes available in ComPacket
+ * @param max_methods Most calls drive accepts in one ComPacket
+ * @return One past last call that fits (first if none do)
+ */
+size_t transaction::pack(vector<size_t> const &call_ends, size_t first,
+                         size_t room, size_t max_methods)
+{
+    size_t used = 0, last = first;
+
+    while ((last < call_ends.size()) && (last - first < max_methods))
+    {
+        size_t call_size = call_ends[last] - (last ? call_ends[last - 1] : 0);
+        if (used + call_size > room)
+        {
+            break;
+        }
+        used += call_size;
+        last++;
+    }
+
+    return last;
+}
+
+/**
+ * \brief Decode per-call statuses from response to a ComPacket of calls
+ *
+ * @param resp Response to ComPacket of calls
+ * @param offset Where first call's response starts
+ * @param count Number of calls sent
+ * @param statuses Filled in with status of each call answered
+ * @return Number of calls answered (drive may stop short after a failure)
+ */
+size_t transaction::decode_statuses(byte_vector const &resp, size_t offset, size_t count,
+                                    datum::status_t *statuses)
+{
+    topaz::byte const *data = (resp.empty() ? NULL : &(resp[0]));
+    size_t len = resp.size(), idx;
+
+    if (offset > len)
+    {
+        throw topaz_exception("Invalid method status on return");
+    }
+
+    for (idx = 0; idx < count; idx++)
+    {
+        // Nothing more, or drive ended transaction itself
+        if ((offset == len) ||
+            (data[offset] == datum::TOK_END_TRANS) ||
+            (data[offset] == datum::TOK_END_SESSION))
+        {
+            break;
+        }
+
+        // Response (if any), End of Data, then [ status, 0, 0 ]
+        if (data[offset] != datum::TOK_END_OF_DATA)
+        {
+            offset += datum_view::skip(data + offset, len - offset);
+        }
+        if ((len - offset < STATUS_SIZE) ||
+            (data[offset] != datum::TOK_END_OF_DATA) ||
+            (data[offset + 1] != datum::TOK_START_LIST) ||
+            (data[offset + 2] > 0x3f) ||
+            (data[offset + 3] != 0) || (data[offset + 4] != 0) ||
+            (data[offset + 5] != datum::TOK_END_LIST))
+        {
+            throw topaz_exception("Invalid method status on return");
+        }
+        statuses[idx] = (datum::status_t)data[offset + 2];
+        offset += STATUS_SIZE;
+    }
+
+    return idx;
+}
+
+/**
+ * \brief Decode status of Start / End Transaction token
+ *
+ * @param resp Response to token
+ * @param token TOK_START_TRANS or TOK_END_TRANS
+ * @return Status returned with token (0 on success)
+ */
+unsigned transaction::decode_trans_status(byte_vector const &resp, topaz::byte token)
+{
+    // Token, then status as a tiny atom
+    if ((resp.size() < TRANS_SIZE) || (resp[0] != token) || (resp[1] > 0x3f))
+    {
+        throw topaz_exception("Invalid transaction status on return");
+    }
+
+    return resp[1];
+}
@@ -0,0 +1,253 @@
+#ifndef TOPAZ_TRANSACTION_H
+#define TOPAZ_TRANSACTION_H
+
+/**
+ * Topaz - Transaction
+ *
+ * This class gathers method calls (Set[], GenKey[], ...) to be applied
+ * atomically, and sends them between Start / End Transaction
+ * tokens, packing as many calls per ComPacket as the drive accepts.
+ *
+ * Copyright (c) 2014, T Parys
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string>
+#include <utility>
+#include <vector>
+#include <topaz/datum.h>
+
+namespace topaz
+{
+
+    class drive;
+
+    class transaction
+    {
+
+      public:
+
+        /**
+         * \brief Constructor
+         *
+         * Nothing is sent to the drive until commit(). If the transaction
+         * goes out of scope without being committed, it is aborted.
+         *
+         * @param target Drive with open session
+         */
+        transaction(drive &target);
+
+        /**
+         * \brief Destructor (aborts uncommitted transaction)
+         */
+        ~transaction();
+
+        /**
+         * \brief Add method call to transaction
+         *
+         * @param object_uid UID indicating object to use for invocation
+         * @param method_uid UID indicating method to call on object
+         * @param params List datum with parameters for method call
+         */
+        void add(uint64_t object_uid, uint64_t method_uid,
+                 datum const &params = datum(datum::LIST));
+
+        /**
+         * \brief Add method call to transaction (call builder)
+         *
+         * @param call Method call, from swg::call()
+         */
+        template <class CALL>
+        void add(CALL const &call)
+        {
+            size_t at = start_call(call.size());
+            call.encode_bytes(&(calls[at]));
+            end_call(call.object_uid(), call.method_uid(), at + call.size());
+        }
+
+        /**
+         * \brief Add Set[] of unsigned value to transaction
+         *
+         * @param tbl_uid Identifier of target table
+         * @param tbl_col Column number of data to set (table specific)
+         * @param val Value to set in column
+         */
+        void set(uint64_t tbl_uid, uint64_t tbl_col, uint64_t val);
+
+        /**
+         * \brief Add Set[] of string value to transaction
+         *
+         * @param tbl_uid Identifier of target table
+         * @param tbl_col Column number of data to set (table specific)
+         * @param val Value to set in column
+         */
+        void set(uint64_t tbl_uid, uint64_t tbl_col, std::string const &val);
+
+        /**
+         * \brief Add Set[] of arbitrary value to transaction
+         *
+         * @param tbl_uid Identifier of target table
+         * @param tbl_col Column number of data to set (table specific)
+         * @param val Value to set in column
+         */
+        void set(uint64_t tbl_uid, uint64_t tbl_col, datum const &val);
+
+        /**
+         * \brief Add GenKey[] to transaction
+         *
+         * @param key_uid Identifier of key object to regenerate
+         */
+        void genkey(uint64_t key_uid);
+
+        /**
+         * \brief Send all calls to drive, and end transaction
+         *
+         * Start Transaction leads the calls, which go in as few
+         * ComPackets as the drive allows (by size and by MaxMethods),
+         * stopping at the first failure. End Transaction follows on its
+         * own: it commits only if every call succeeded, and aborts
+         * otherwise, so either all calls take effect or none do. When
+         * the drive accepts all calls in one ComPacket, that is two round
+         * trips. Per-call status is available from get_status(). If the
+         * drive refuses to start the transaction, calls it answered in
+         * the first ComPacket ran outside of it, and report their own
+         * status. Anything thrown once the transaction may be open on
+         * the drive aborts it before passing on.
+         *
+         * @return STA_SUCCESS, or status of first failing call
+         */
+        datum::status_t commit();
+
+        /**
+         * \brief Drop all calls, without applying any of them
+         */
+        void abort();
+
+        /**
+         * \brief Query number of calls in transaction
+         */
+        size_t size() const;
+
+        /**
+         * \brief Query status of call, after commit()
+         *
+         * @param idx Call number, in order added
+         * @return Status reported by call (STA_TRANSACTION_FAILURE if never run)
+         */
+        datum::status_t get_status(size_t idx) const;
+
+        /**
+         * \brief Count calls fitting in one ComPacket
+         *
+         * @param call_ends Offset just past each encoded call
+         * @param first First call to send
+         * @param room Payload bytes available in ComPacket
+         * @param max_methods Most calls drive accepts in one ComPacket
+         * @return One past last call that fits (first if none do)
+         */
+        static size_t pack(std::vector<size_t> const &call_ends, size_t first,
+                           size_t room, size_t max_methods);
+
+        /**
+         * \brief Decode per-call statuses from response to a ComPacket of calls
+         *
+         * @param resp Response to ComPacket of calls
+         * @param offset Where first call's response starts
+         * @param count Number of calls sent
+         * @param statuses Filled in with status of each call answered
+         * @return Number of calls answered (drive may stop short after a failure)
+         */
+        static size_t decode_statuses(byte_vector const &resp, size_t offset,
+                                      size_t count, datum::status_t *statuses);
+
+        /**
+         * \brief Decode status of Start / End Transaction token
+         *
+         * @param resp Response to token
+         * @param token TOK_START_TRANS or TOK_END_TRANS
+         * @return Status returned with token (0 on success)
+         */
+        static unsigned decode_trans_status(byte_vector const &resp, byte token);
+
+      protected:
+
+        /**
+         * \brief Make room for encoded call
+         *
+         * @param call_size Bytes of encoded call
+         * @return Offset to encode call at
+         */
+        size_t start_call(size_t call_size);
+
+        /**
+         * \brief Finish call (End of Data, and status list) after encoding
+         *
+         * @param object_uid UID indicating object to use for invocation
+         * @param method_uid UID indicating method to call on object
+         * @param end Offset just past encoded call
+         */
+        void end_call(uint64_t object_uid, uint64_t method_uid, size_t end);
+
+        /**
+         * \brief Send one ComPacket worth of calls, and collect statuses
+         *
+         * @param first First call to send
+         * @param last One past last call to send
+         * @param start Lead with Start Transaction
+         * @return STA_SUCCESS, or status of first failing call
+         */
+        datum::status_t exchange(size_t first, size_t last, bool start);
+
+        /**
+         * \brief Send Start / End Transaction token on its own
+         *
+         * @param token TOK_START_TRANS or TOK_END_TRANS
+         * @param code Status to send with token (End Transaction: 0 commit, 1 abort)
+         * @return Status returned with token (0 on success)
+         */
+        unsigned send_trans(byte token, byte code);
+
+        /**
+         * \brief Abort transaction already started on drive
+         */
+        void send_abort();
+
+        // Where to send
+        drive &target;
+
+        // Encoded calls, each with End of Data and status list
+        byte_vector calls;
+        std::vector<size_t> call_ends;
+        std::vector<std::pair<uint64_t, uint64_t> > call_uids;
+
+        // Results
+        std::vector<datum::status_t> statuses;
+        byte_vector resp;
+        bool started;
+        bool done;
+
+    };
+
+};
+
+#endif
@@ -31,6 +31,8 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <topaz/defs.h>
+
 #define _UID_MAKE(high, low) (((high) * 0x100000000ULL) + (low))
 #define _UID_HIGH(uid)       ((uid) / 0x100000000ULL)
 #define _UID_LOW(uid)        ((uid) & 0x0ffffffffULL)
@@ -55,6 +57,16 @@ namespace topaz
         LOCKING_SP       = _UID_MAKE( 0x205,     0x2)
     };
 
+    // Tables (object tables, whose rows are listed by Next[])
+    enum
+    {
+        TABLE_TABLE      = _UID_MAKE(   0x1,     0x0), // Table of tables (descriptors)
+        ACE_TABLE        = _UID_MAKE(   0x8,     0x0), // Access Control Entries
+        AUTHORITY_TABLE  = _UID_MAKE(   0x9,     0x0), // Authorities (users & groups)
+        C_PIN_TABLE      = _UID_MAKE(   0xb,     0x0), // PINs of Authorities
+        LOCKING_TABLE    = _UID_MAKE( 0x802,     0x0)  // Locking Ranges
+    };
+
     // Defined UIDs within Admin SP
     enum
     {
@@ -119,6 +131,9 @@ namespace topaz
     // TCG Opal Method Calls
     enum
     {
+        // Next[] - SWG Core Spec - 5.3.3.13
+        NEXT          = _UID_MAKE(6,   0x08),
+
         GENKEY        = _UID_MAKE(6,   0x10), // Generate new key
         REVERT_SP     = _UID_MAKE(6,   0x11), // RevertSP
 
@@ -133,6 +148,70 @@ namespace topaz
         ACTIVATE      = _UID_MAKE(6,  0x203)  // Activate
     };
 
+    ////
+    // Pre-encoded UIDs
+    //
+
+    // UID as encoded in data stream (short binary atom header + 8 big
+    // endian bytes). Encoders copy these in as is, rather than building
+    // an atom for every object / method reference.
+    typedef struct
+    {
+        byte bytes[9];
+    } uid_token_t;
+
+    /**
+     * \brief Encode UID as a token (at compile time, for constants)
+     */
+    constexpr uid_token_t uid_token(uint64_t uid)
+    {
+        return {{0xa8,
+                 (byte)(uid >> 56), (byte)(uid >> 48), (byte)(uid >> 40), (byte)(uid >> 32),
+                 (byte)(uid >> 24), (byte)(uid >> 16), (byte)(uid >>  8), (byte)(uid)}};
+    }
+
+    // Every UID named above (aliases, eg - LOCKING, come after the
+    // name preferred for tracing)
+#define TOPAZ_UIDS(X)                                                     \
+    X(SESSION_MGR) X(ADMIN_SP) X(LOCKING_SP)                              \
+    X(TABLE_TABLE) X(ACE_TABLE) X(AUTHORITY_TABLE) X(C_PIN_TABLE)         \
+    X(LOCKING_TABLE)                                                      \
+    X(SP_INFO) X(ANYBODY) X(SID) X(PSID) X(C_PIN_SID) X(C_PIN_MSID)       \
+    X(ACE_DATASTORE_GET) X(ACE_DATASTORE_SET) X(ADMINS) X(ADMIN_BASE)     \
+    X(USER_BASE) X(C_PIN_ADMIN_BASE) X(C_PIN_USER_BASE) X(LOCKINGINFO)    \
+    X(LBA_RANGE_GLOBAL) X(LOCKING) X(MBR_CONTROL) X(MBR_UID) X(MBR)       \
+    X(LBA_RANGE_BASE) X(DATASTORE)                                        \
+    X(PROPERTIES) X(START_SESSION) X(SYNC_SESSION)                        \
+    X(NEXT) X(GENKEY) X(REVERT_SP) X(GET) X(SET) X(REVERT) X(ACTIVATE)
+
+    // Pre-encoded token of each, eg - GET_TOKEN
+#define _UID_TOKEN(name) constexpr uid_token_t name##_TOKEN = uid_token(name);
+    TOPAZ_UIDS(_UID_TOKEN)
+#undef _UID_TOKEN
+
+    // UID -> name, for tracing
+    typedef struct
+    {
+        uint64_t    uid;
+        char const *name;
+    } uid_name_t;
+
+#define _UID_NAME(name) {name, #name},
+    constexpr uid_name_t uid_names[] = { TOPAZ_UIDS(_UID_NAME) };
+#undef _UID_NAME
+
+    /**
+     * \brief Look up name of well known UID
+     *
+     * @param uid UID to look up
+     * @return Name of UID, or NULL if not known
+     */
+    constexpr char const *uid_name(uint64_t uid, size_t idx = 0)
+    {
+        return (idx == sizeof(uid_names) / sizeof(uid_names[0]) ? NULL :
+                (uid_names[idx].uid == uid ? uid_names[idx].name : uid_name(uid, idx + 1)));
+    }
+
     ////
     // Table Column Definitions
     //